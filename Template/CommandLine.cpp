@@ -0,0 +1,128 @@
+#include "CommandLine.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+bool parse_command_line(int argc, char** argv, int first, const std::vector<CommandOption>& options, const char* usage)
+{
+	size_t nextPositional = 0;
+
+	for (int i = first; i < argc; i++)
+	{
+		const CommandOption* option = nullptr;
+		const char* value = nullptr;
+
+		if (argv[i][0] == '-' && argv[i][1] == '-')
+		{
+			for (const CommandOption& candidate : options)
+			{
+				if (candidate.name != nullptr && std::strcmp(candidate.name, argv[i]) == 0)
+					option = &candidate;
+			}
+
+			if (option == nullptr)
+			{
+				std::cerr << "Unknown option " << argv[i] << std::endl << "usage: " << usage << std::endl;
+				return false;
+			}
+			if (i + 1 >= argc)
+			{
+				std::cerr << "Missing value for " << argv[i] << std::endl << "usage: " << usage << std::endl;
+				return false;
+			}
+			value = argv[++i];
+		}
+		else
+		{
+			// positional arguments in the order they are listed
+			for (; nextPositional < options.size() && option == nullptr; nextPositional++)
+			{
+				if (options[nextPositional].name == nullptr)
+					option = &options[nextPositional];
+			}
+
+			if (option == nullptr)
+			{
+				std::cerr << "Unexpected argument " << argv[i] << std::endl << "usage: " << usage << std::endl;
+				return false;
+			}
+			value = argv[i];
+		}
+
+		if (!option->parse(value))
+		{
+			std::cerr << "Invalid value " << value << (option->name != nullptr ? " for " : "") << (option->name != nullptr ? option->name : "")
+				<< std::endl << "usage: " << usage << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool parse_uint64(const char* text, std::uint64_t& value)
+{
+	// strtoull accepts signs and leading spaces, only plain digits are a valid count
+	if (text == nullptr || !std::isdigit(static_cast<unsigned char>(text[0])))
+		return false;
+
+	char* end = nullptr;
+	errno = 0;
+	unsigned long long parsed = std::strtoull(text, &end, 10);
+	if (errno != 0 || *end != '\0')
+		return false;
+
+	value = parsed;
+	return true;
+}
+
+bool parse_unsigned(const char* text, unsigned& value, unsigned min, unsigned max)
+{
+	std::uint64_t parsed = 0;
+	if (!parse_uint64(text, parsed) || parsed < min || parsed > max)
+		return false;
+
+	value = static_cast<unsigned>(parsed);
+	return true;
+}
+
+bool parse_size(const char* text, int& width, int& height)
+{
+	const char* separator = std::strchr(text, 'x');
+	if (separator == nullptr)
+		return false;
+
+	std::string widthText(text, separator);
+	unsigned w = 0, h = 0;
+	if (!parse_unsigned(widthText.c_str(), w, 1, 16384) || !parse_unsigned(separator + 1, h, 1, 16384))
+		return false;
+
+	width = static_cast<int>(w);
+	height = static_cast<int>(h);
+	return true;
+}
+
+bool parse_unsigned_list(const char* text, std::vector<unsigned>& values, unsigned min)
+{
+	values.clear();
+
+	std::string list(text);
+	size_t start = 0;
+	for (;;)
+	{
+		size_t comma = list.find(',', start);
+		std::string item = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+
+		unsigned value = 0;
+		if (!parse_unsigned(item.c_str(), value, min))
+			return false;
+		values.push_back(value);
+
+		if (comma == std::string::npos)
+			return true;
+		start = comma + 1;
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef COMMAND_LINE_H
+#define COMMAND_LINE_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// one argument of a windowless mode, parse returns false if the value is invalid
+struct CommandOption
+{
+	const char* name;			// flag such as "--ticks", nullptr for a positional argument
+	std::function<bool(const char* value)> parse;
+};
+
+// parse argv[first..argc), positional options are filled in order, every flag takes one value
+// unknown flags, missing values and invalid values print the error and usage to stderr and return false
+bool parse_command_line(int argc, char** argv, int first, const std::vector<CommandOption>& options, const char* usage);
+
+// strict number parsing, the whole string must be a value in [min, max]
+bool parse_unsigned(const char* text, unsigned& value, unsigned min = 0, unsigned max = 0xFFFFFFFFu);
+bool parse_uint64(const char* text, std::uint64_t& value);
+// "WxH", both at least 1
+bool parse_size(const char* text, int& width, int& height);
+// comma separated list such as "1000,5000,20000"
+bool parse_unsigned_list(const char* text, std::vector<unsigned>& values, unsigned min = 0);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef CPU_SUPPORT_H
+#define CPU_SUPPORT_H
+
+#include <chrono>
+
+// SIMD selection and timing shared by the CPU paths (fleet, particles, software renderer)
+
+// SSE2 is always available on x86/x64 builds, other targets use the scalar path
+// define USE_SSE2 as 0 to force the scalar path everywhere, e.g. to check it against the SSE2 one
+#ifndef USE_SSE2
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define USE_SSE2 1
+#else
+#define USE_SSE2 0
+#endif
+#endif
+
+#if USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// milliseconds since start
+inline float elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif
@@ -0,0 +1,424 @@
+#include "Fleet.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <glm/glm.hpp>
+#include "CpuSupport.h"
+#include "TruckGeometry.h"
+
+// collision shapes in truck space, built from the same outlines as the truck vertices
+namespace
+{
+	struct Polygon
+	{
+		glm::vec2 points[6];
+		int count;
+	};
+
+	struct Circle
+	{
+		glm::vec2 centre;
+		float radius;
+	};
+
+	// a truck's parts placed in the world
+	struct TruckShape
+	{
+		Polygon parts[3];	// cabin, base, tray
+		Circle wheels[2];	// front, back
+	};
+
+	Polygon make_polygon(const glm::vec2* points, int count)
+	{
+		Polygon polygon;
+		for (int i = 0; i < count; i++)
+			polygon.points[i] = points[i];
+		polygon.count = count;
+		return polygon;
+	}
+
+	const Polygon CABIN = make_polygon(CABIN_OUTLINE, CABIN_POINTS);
+	const Polygon BASE = make_polygon(BASE_OUTLINE, BASE_POINTS);
+	const Polygon TRAY = make_polygon(TRAY_OUTLINE, TRAY_POINTS);
+	const Circle FRONT_WHEEL = { FRONT_WHEEL_CENTRE, TYRE_RADIUS };
+	const Circle BACK_WHEEL = { BACK_WHEEL_CENTRE, TYRE_RADIUS };
+
+	// x extent of a truck with the tray lowered, the chassis and tray reach furthest
+	float outline_min_x(const glm::vec2* points, int count)
+	{
+		float min = points[0].x;
+		for (int i = 1; i < count; i++)
+			min = std::min(min, points[i].x);
+		return min;
+	}
+
+	float outline_max_x(const glm::vec2* points, int count)
+	{
+		float max = points[0].x;
+		for (int i = 1; i < count; i++)
+			max = std::max(max, points[i].x);
+		return max;
+	}
+
+	const float TRUCK_MIN_X = std::min(outline_min_x(BASE_OUTLINE, BASE_POINTS), outline_min_x(TRAY_OUTLINE, TRAY_POINTS));
+	const float TRUCK_MAX_X = std::max(outline_max_x(BASE_OUTLINE, BASE_POINTS), outline_max_x(TRAY_OUTLINE, TRAY_POINTS));
+
+	// rotate the tray about its pivot by -angle degrees, same as the tray model matrix
+	Polygon tipped_tray(float angle, float x)
+	{
+		float radians = -angle * 3.14159265f / 180.0f;
+		float c = std::cos(radians);
+		float s = std::sin(radians);
+
+		Polygon tray = TRAY;
+		for (int i = 0; i < tray.count; i++)
+		{
+			glm::vec2 p = TRAY.points[i] - TRAY_PIVOT;
+			tray.points[i] = glm::vec2(TRAY_PIVOT.x + c * p.x - s * p.y + x, TRAY_PIVOT.y + s * p.x + c * p.y);
+		}
+		return tray;
+	}
+
+	Polygon translated(const Polygon& polygon, float x)
+	{
+		Polygon result = polygon;
+		for (int i = 0; i < result.count; i++)
+			result.points[i].x += x;
+		return result;
+	}
+
+	TruckShape make_truck_shape(const Truck& truck)
+	{
+		TruckShape shape;
+		shape.parts[0] = translated(CABIN, truck.x);
+		shape.parts[1] = translated(BASE, truck.x);
+		shape.parts[2] = tipped_tray(truck.trayAngle, truck.x);
+		shape.wheels[0] = { glm::vec2(FRONT_WHEEL.centre.x + truck.x, FRONT_WHEEL.centre.y), FRONT_WHEEL.radius };
+		shape.wheels[1] = { glm::vec2(BACK_WHEEL.centre.x + truck.x, BACK_WHEEL.centre.y), BACK_WHEEL.radius };
+		return shape;
+	}
+
+	Polygon make_obstacle_shape(const Obstacle& obstacle)
+	{
+		float left = obstacle.x - obstacle.halfWidth;
+		float right = obstacle.x + obstacle.halfWidth;
+		return { { glm::vec2(left, GROUND_Y), glm::vec2(right, GROUND_Y), glm::vec2(right, GROUND_Y + obstacle.height), glm::vec2(left, GROUND_Y + obstacle.height) }, 4 };
+	}
+
+	void project(const Polygon& polygon, glm::vec2 axis, float& min, float& max)
+	{
+		min = max = glm::dot(polygon.points[0], axis);
+		for (int i = 1; i < polygon.count; i++)
+		{
+			float d = glm::dot(polygon.points[i], axis);
+			min = std::min(min, d);
+			max = std::max(max, d);
+		}
+	}
+
+	// true if no edge normal of a separates a and b
+	bool no_separating_edge(const Polygon& a, const Polygon& b)
+	{
+		for (int i = 0; i < a.count; i++)
+		{
+			glm::vec2 edge = a.points[(i + 1) % a.count] - a.points[i];
+			glm::vec2 axis(-edge.y, edge.x);
+
+			float minA, maxA, minB, maxB;
+			project(a, axis, minA, maxA);
+			project(b, axis, minB, maxB);
+			if (maxA < minB || maxB < minA)
+				return false;
+		}
+		return true;
+	}
+
+	// separating axis test for two convex polygons
+	bool overlap(const Polygon& a, const Polygon& b)
+	{
+		return no_separating_edge(a, b) && no_separating_edge(b, a);
+	}
+
+	bool overlap(const Circle& a, const Circle& b)
+	{
+		glm::vec2 d = a.centre - b.centre;
+		float r = a.radius + b.radius;
+		return glm::dot(d, d) < r * r;
+	}
+
+	// separating axis test, the extra axis runs from the closest vertex to the circle centre
+	bool overlap(const Polygon& polygon, const Circle& circle)
+	{
+		float closest = 1.0e30f;
+		glm::vec2 closestAxis(0.0f, 1.0f);
+
+		for (int i = 0; i < polygon.count; i++)
+		{
+			glm::vec2 toCentre = circle.centre - polygon.points[i];
+			float distance = glm::dot(toCentre, toCentre);
+			if (distance < closest)
+			{
+				closest = distance;
+				closestAxis = toCentre;
+			}
+		}
+
+		for (int i = 0; i <= polygon.count; i++)
+		{
+			glm::vec2 axis;
+			if (i < polygon.count)
+			{
+				glm::vec2 edge = polygon.points[(i + 1) % polygon.count] - polygon.points[i];
+				axis = glm::vec2(-edge.y, edge.x);
+			}
+			else
+			{
+				axis = closestAxis;
+			}
+
+			float length = std::sqrt(glm::dot(axis, axis));
+			if (length == 0.0f)
+				continue;
+			axis = axis * (1.0f / length);
+
+			float min, max;
+			project(polygon, axis, min, max);
+			float centre = glm::dot(circle.centre, axis);
+			if (max < centre - circle.radius || centre + circle.radius < min)
+				return false;
+		}
+		return true;
+	}
+
+	bool overlap(const TruckShape& a, const TruckShape& b)
+	{
+		for (const Polygon& partA : a.parts)
+		{
+			for (const Polygon& partB : b.parts)
+				if (overlap(partA, partB)) return true;
+			for (const Circle& wheelB : b.wheels)
+				if (overlap(partA, wheelB)) return true;
+		}
+		for (const Circle& wheelA : a.wheels)
+		{
+			for (const Polygon& partB : b.parts)
+				if (overlap(partB, wheelA)) return true;
+			for (const Circle& wheelB : b.wheels)
+				if (overlap(wheelA, wheelB)) return true;
+		}
+		return false;
+	}
+
+	bool overlap(const TruckShape& truck, const Polygon& obstacle)
+	{
+		for (const Polygon& part : truck.parts)
+			if (overlap(part, obstacle)) return true;
+		for (const Circle& wheel : truck.wheels)
+			if (overlap(obstacle, wheel)) return true;
+		return false;
+	}
+}
+
+void truck_extent(const Truck& truck, float& minX, float& maxX)
+{
+	minX = TRUCK_MIN_X;
+	maxX = TRUCK_MAX_X;
+
+	// a tipped tray swings out behind the truck
+	if (truck.trayAngle != 0.0f)
+	{
+		Polygon tray = tipped_tray(truck.trayAngle, 0.0f);
+		for (int p = 0; p < tray.count; p++)
+		{
+			minX = std::min(minX, tray.points[p].x);
+			maxX = std::max(maxX, tray.points[p].x);
+		}
+	}
+}
+
+void Fleet::spawn(unsigned numTrucks, unsigned numObstacles, bool steerFirst)
+{
+	// fixed seed so the same settings always give the same fleet
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	mTrucks.assign(std::max(1u, numTrucks), Truck());
+	mTrucks[0].steered = steerFirst;
+	if (!steerFirst)
+		mTrucks[0].speed = (unit(generator) - 0.5f) * 0.8f;
+
+	// the others alternate either side of the player with gaps and random speeds
+	for (unsigned i = 1; i < mTrucks.size(); i++)
+	{
+		float distance = 1.2f * ((i + 1) / 2) + 0.3f * unit(generator);
+		mTrucks[i].x = (i % 2 == 1) ? distance : -distance;
+		mTrucks[i].speed = (unit(generator) - 0.5f) * 0.8f;
+	}
+
+	// obstacles sit beyond the trucks on both ends of the road
+	float roadEnd = 1.2f * ((mTrucks.size() + 1) / 2) + 1.0f;
+	mObstacles.assign(numObstacles, Obstacle());
+	for (unsigned i = 0; i < numObstacles; i++)
+	{
+		float distance = roadEnd + 0.5f * (i / 2);
+		mObstacles[i].x = (i % 2 == 0) ? distance : -distance;
+		mObstacles[i].height = 0.05f + 0.1f * unit(generator);
+	}
+
+	size_t numBodies = mTrucks.size() + mObstacles.size();
+	mPreviousX.resize(mTrucks.size());
+	mMinX.resize(numBodies);
+	mMaxX.resize(numBodies);
+
+	updateBounds();
+
+	// the spawn order is far from sorted, so start from a full sort and let insertion sort keep it up
+	mOrder.resize(numBodies);
+	for (size_t i = 0; i < numBodies; i++)
+		mOrder[i] = static_cast<std::uint32_t>(i);
+	std::sort(mOrder.begin(), mOrder.end(), [this](std::uint32_t a, std::uint32_t b) { return mMinX[a] < mMinX[b]; });
+}
+
+void Fleet::step(float deltaTime)
+{
+	for (size_t i = 0; i < mTrucks.size(); i++)
+	{
+		Truck& truck = mTrucks[i];
+		mPreviousX[i] = truck.x;
+		truck.x += truck.speed * deltaTime;
+		truck.wheelAngle -= truck.speed * mWheelRatio * deltaTime;
+	}
+
+	auto broadStart = std::chrono::steady_clock::now();
+	updateBounds();
+	sortBounds();
+	sweep();
+	mStats.broadPhaseMs = elapsed_ms(broadStart);
+
+	auto narrowStart = std::chrono::steady_clock::now();
+	mStats.candidatePairs = static_cast<unsigned>(mPairs.size() / 2);
+	mStats.contacts = 0;
+	for (size_t i = 0; i < mPairs.size(); i += 2)
+	{
+		if (overlaps(mPairs[i], mPairs[i + 1]))
+		{
+			mStats.contacts++;
+			resolve(mPairs[i], mPairs[i + 1]);
+		}
+	}
+	mStats.narrowPhaseMs = elapsed_ms(narrowStart);
+}
+
+void Fleet::updateBounds()
+{
+	for (size_t i = 0; i < mTrucks.size(); i++)
+	{
+		float min, max;
+		truck_extent(mTrucks[i], min, max);
+		mMinX[i] = mTrucks[i].x + min;
+		mMaxX[i] = mTrucks[i].x + max;
+	}
+
+	size_t base = mTrucks.size();
+	for (size_t i = 0; i < mObstacles.size(); i++)
+	{
+		mMinX[base + i] = mObstacles[i].x - mObstacles[i].halfWidth;
+		mMaxX[base + i] = mObstacles[i].x + mObstacles[i].halfWidth;
+	}
+}
+
+void Fleet::sortBounds()
+{
+	// insertion sort, bodies barely move between steps so this is close to linear
+	for (size_t i = 1; i < mOrder.size(); i++)
+	{
+		std::uint32_t body = mOrder[i];
+		float key = mMinX[body];
+
+		size_t j = i;
+		while (j > 0 && mMinX[mOrder[j - 1]] > key)
+		{
+			mOrder[j] = mOrder[j - 1];
+			j--;
+		}
+		mOrder[j] = body;
+	}
+}
+
+void Fleet::sweep()
+{
+	mPairs.clear();
+
+	// every body after i that starts before i ends overlaps it on x
+	for (size_t i = 0; i < mOrder.size(); i++)
+	{
+		std::uint32_t a = mOrder[i];
+		float maxA = mMaxX[a];
+
+		for (size_t j = i + 1; j < mOrder.size() && mMinX[mOrder[j]] <= maxA; j++)
+		{
+			std::uint32_t b = mOrder[j];
+
+			// obstacles never move, so obstacle pairs are not interesting
+			if (a >= mTrucks.size() && b >= mTrucks.size())
+				continue;
+
+			// keep the truck first
+			mPairs.push_back(std::min(a, b));
+			mPairs.push_back(std::max(a, b));
+		}
+	}
+}
+
+bool Fleet::overlaps(std::uint32_t a, std::uint32_t b) const
+{
+	TruckShape shapeA = make_truck_shape(mTrucks[a]);
+
+	if (b < mTrucks.size())
+		return overlap(shapeA, make_truck_shape(mTrucks[b]));
+
+	return overlap(shapeA, make_obstacle_shape(mObstacles[b - mTrucks.size()]));
+}
+
+void Fleet::resolve(std::uint32_t a, std::uint32_t b)
+{
+	Truck& truckA = mTrucks[a];
+
+	// obstacle, undo the move and turn around
+	if (b >= mTrucks.size())
+	{
+		const Obstacle& obstacle = mObstacles[b - mTrucks.size()];
+		if (truckA.speed * (obstacle.x - truckA.x) > 0.0f || truckA.steered)
+		{
+			truckA.x = mPreviousX[a];
+			if (!truckA.steered)
+				truckA.speed = -truckA.speed;
+		}
+		return;
+	}
+
+	Truck& truckB = mTrucks[b];
+
+	// only resolve trucks moving towards each other, overlapping trucks moving apart are left to separate
+	if ((truckA.speed - truckB.speed) * (truckB.x - truckA.x) <= 0.0f)
+		return;
+
+	truckA.x = mPreviousX[a];
+	truckB.x = mPreviousX[b];
+
+	if (truckA.steered)
+	{
+		// the steered truck acts as a wall
+		truckB.speed = std::copysign(truckB.speed, truckB.x - truckA.x);
+	}
+	else if (truckB.steered)
+	{
+		truckA.speed = std::copysign(truckA.speed, truckA.x - truckB.x);
+	}
+	else
+	{
+		// equal masses on a line swap velocities
+		std::swap(truckA.speed, truckB.speed);
+	}
+}
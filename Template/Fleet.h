@@ -0,0 +1,77 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <cstdint>
+#include <vector>
+
+// truck state, trucks only move along x
+struct Truck
+{
+	float x = 0.0f;				// position along the road
+	float speed = 0.0f;			// velocity along the road
+	float wheelAngle = 0.0f;	// wheel rotation in radians
+	float trayAngle = 0.0f;		// tipper angle in degrees, 0 is lowered
+	bool steered = false;		// speed is set from outside, collisions block it instead of changing its speed
+};
+
+// x interval covered by a truck's shapes relative to its position, a tipped tray swings out behind it
+void truck_extent(const Truck& truck, float& minX, float& maxX);
+
+// static box standing on the ground
+struct Obstacle
+{
+	float x = 0.0f;				// centre along the road
+	float halfWidth = 0.05f;
+	float height = 0.1f;
+};
+
+// collision stats for the last step
+struct FleetStats
+{
+	unsigned candidatePairs = 0;	// pairs whose x intervals overlap
+	unsigned contacts = 0;			// pairs whose shapes overlap
+	float broadPhaseMs = 0.0f;		// bounds update, sort and sweep
+	float narrowPhaseMs = 0.0f;		// exact shape tests and response
+};
+
+// trucks and obstacles on one road with sweep and prune collision
+class Fleet
+{
+public:
+	// replace the fleet, if steerFirst truck 0 is a steered player truck at the origin
+	void spawn(unsigned numTrucks, unsigned numObstacles, bool steerFirst = true);
+	// move every truck and resolve collisions
+	void step(float deltaTime);
+
+	std::vector<Truck>& getTrucks() { return mTrucks; }
+	const std::vector<Truck>& getTrucks() const { return mTrucks; }
+	const std::vector<Obstacle>& getObstacles() const { return mObstacles; }
+	const FleetStats& getStats() const { return mStats; }
+
+	// x interval covered by a body after the last step, trucks first then obstacles
+	float getMinX(unsigned body) const { return mMinX[body]; }
+	float getMaxX(unsigned body) const { return mMaxX[body]; }
+
+	// wheel rotation per unit of distance travelled
+	float mWheelRatio = 3.0f;
+
+private:
+	std::vector<Truck> mTrucks;
+	std::vector<Obstacle> mObstacles;
+	std::vector<float> mPreviousX;		// truck positions before this step, restored on contact
+
+	// broad phase
+	std::vector<float> mMinX, mMaxX;	// body x intervals
+	std::vector<std::uint32_t> mOrder;	// body ids sorted by mMinX, kept between steps
+	std::vector<std::uint32_t> mPairs;	// candidate pairs, two ids each
+
+	FleetStats mStats;
+
+	void updateBounds();
+	void sortBounds();
+	void sweep();
+	bool overlaps(std::uint32_t a, std::uint32_t b) const;
+	void resolve(std::uint32_t a, std::uint32_t b);
+};
+
+#endif
@@ -0,0 +1,304 @@
+#include "ParticleSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "CpuSupport.h"
+#include "WorkerPool.h"
+
+#if USE_SSE2
+// per lane mask ? a : b
+static inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+ParticleSystem::ParticleSystem()
+{}
+
+ParticleSystem::~ParticleSystem()
+{
+	if (mVBO != 0)
+		glDeleteBuffers(1, &mVBO);
+	if (mVAO != 0)
+		glDeleteVertexArrays(1, &mVAO);
+}
+
+void ParticleSystem::setCollider(const std::vector<glm::vec2>& polygon)
+{
+	mEdgeNormals.clear();
+	mEdgeOffsets.clear();
+
+	float bestUp = -1.0f;
+	for (size_t i = 0; i < polygon.size(); i++)
+	{
+		glm::vec2 a = polygon[i];
+		glm::vec2 b = polygon[(i + 1) % polygon.size()];
+
+		// outward normal of a counter clockwise edge
+		glm::vec2 normal(b.y - a.y, a.x - b.x);
+		float length = std::sqrt(glm::dot(normal, normal));
+		normal = normal * (1.0f / length);
+
+		mEdgeNormals.push_back(normal);
+		mEdgeOffsets.push_back(glm::dot(normal, a));
+
+		// the most upward facing edge is where the load is piled
+		if (normal.y > bestUp)
+		{
+			bestUp = normal.y;
+			mHeapLeft = std::min(a.x, b.x);
+			mHeapRight = std::max(a.x, b.x);
+			mHeapBase = std::max(a.y, b.y);
+		}
+	}
+}
+
+void ParticleSystem::reset(unsigned count)
+{
+	mCount = count;
+	mCapacity = (count + 3) & ~3u;
+
+	mPosX.assign(mCapacity, 0.0f);
+	mPosY.assign(mCapacity, 0.0f);
+	mVelX.assign(mCapacity, 0.0f);
+	mVelY.assign(mCapacity, 0.0f);
+	mLocalX.assign(mCapacity, 0.0f);
+	mLocalY.assign(mCapacity, 0.0f);
+	mReleaseAngle.assign(mCapacity, 0.0f);
+	mReleased.assign(mCapacity, 0);
+
+	// fixed seed so every reset gives the same heap
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	float left = mHeapLeft + mRadius;
+	float right = mHeapRight - mRadius;
+	float middle = (left + right) * 0.5f;
+	float halfWidth = (right - left) * 0.5f;
+	float heapHeight = halfWidth * 0.4f;
+
+	for (unsigned i = 0; i < mCapacity; i++)
+	{
+		// mound shaped heap, highest in the middle of the tray
+		float x = left + unit(generator) * (right - left);
+		float t = (x - middle) / halfWidth;
+		float height = heapHeight * (1.0f - t * t);
+		float y = unit(generator) * height;
+
+		mLocalX[i] = x;
+		mLocalY[i] = mHeapBase + mRadius + y;
+
+		// the top of the heap slides first, the bottom layer needs the tray almost fully tipped
+		float depth = 1.0f - y / heapHeight;
+		mReleaseAngle[i] = 2.0f + 38.0f * depth * (0.5f + 0.5f * unit(generator));
+	}
+}
+
+void ParticleSystem::update(float deltaTime, const glm::mat4& trayMatrix, float trayAngle)
+{
+	// large steps would tunnel through the tray
+	deltaTime = std::min(deltaTime, 1.0f / 30.0f);
+
+	unsigned numJobs = std::max(1u, mNumThreads);
+	unsigned chunk = ((mCapacity / numJobs) + 3) & ~3u;
+	if (chunk < 1024)
+		chunk = mCapacity; // not worth waking workers for small loads
+	if (chunk == 0)
+		return;
+
+	// chunks go to the shared worker pool, this thread takes some too
+	numJobs = (mCapacity + chunk - 1) / chunk;
+	WorkerPool::shared().run(numJobs, [this, chunk, deltaTime, &trayMatrix, trayAngle](unsigned job) {
+		unsigned begin = job * chunk;
+		updateRange(begin, std::min(begin + chunk, mCapacity), deltaTime, trayMatrix, trayAngle);
+	});
+}
+
+void ParticleSystem::updateRange(unsigned begin, unsigned end, float deltaTime, const glm::mat4& trayMatrix, float trayAngle)
+{
+	// the tray is a rotation and translation, so its inverse is the transposed rotation
+	float m00 = trayMatrix[0][0], m01 = trayMatrix[0][1];
+	float m10 = trayMatrix[1][0], m11 = trayMatrix[1][1];
+	float tx = trayMatrix[3][0], ty = trayMatrix[3][1];
+
+	size_t numEdges = mEdgeNormals.size();
+	float groundY = mGroundY + mRadius;
+	float keep = 1.0f - mFriction;
+
+#if USE_SSE2
+	const __m128 vDt = _mm_set1_ps(deltaTime);
+	const __m128 vGravityStep = _mm_set1_ps(mGravity * deltaTime);
+	const __m128 vAngle = _mm_set1_ps(trayAngle);
+	const __m128 vM00 = _mm_set1_ps(m00), vM01 = _mm_set1_ps(m01);
+	const __m128 vM10 = _mm_set1_ps(m10), vM11 = _mm_set1_ps(m11);
+	const __m128 vTx = _mm_set1_ps(tx), vTy = _mm_set1_ps(ty);
+	const __m128 vRadius = _mm_set1_ps(mRadius);
+	const __m128 vGround = _mm_set1_ps(groundY);
+	const __m128 vBounce = _mm_set1_ps(1.0f + mRestitution);
+	const __m128 vRestitution = _mm_set1_ps(mRestitution);
+	const __m128 vKeep = _mm_set1_ps(keep);
+	const __m128 vZero = _mm_setzero_ps();
+	const __m128 vOne = _mm_set1_ps(1.0f);
+
+	for (unsigned i = begin; i < end; i += 4)
+	{
+		// latch particles whose release angle has been reached
+		__m128 released = _mm_loadu_ps(reinterpret_cast<const float*>(&mReleased[i]));
+		released = _mm_or_ps(released, _mm_cmpge_ps(vAngle, _mm_loadu_ps(&mReleaseAngle[i])));
+		_mm_storeu_ps(reinterpret_cast<float*>(&mReleased[i]), released);
+
+		// loaded particles ride along with the tray
+		__m128 lx = _mm_loadu_ps(&mLocalX[i]);
+		__m128 ly = _mm_loadu_ps(&mLocalY[i]);
+		__m128 restX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vM00, lx), _mm_mul_ps(vM10, ly)), vTx);
+		__m128 restY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vM01, lx), _mm_mul_ps(vM11, ly)), vTy);
+
+		// integrate free particles
+		__m128 vx = _mm_loadu_ps(&mVelX[i]);
+		__m128 vy = _mm_sub_ps(_mm_loadu_ps(&mVelY[i]), vGravityStep);
+		__m128 px = _mm_add_ps(_mm_loadu_ps(&mPosX[i]), _mm_mul_ps(vx, vDt));
+		__m128 py = _mm_add_ps(_mm_loadu_ps(&mPosY[i]), _mm_mul_ps(vy, vDt));
+
+		// tray collision, find the edge of least penetration in tray space
+		__m128 dx = _mm_sub_ps(px, vTx);
+		__m128 dy = _mm_sub_ps(py, vTy);
+		__m128 localX = _mm_add_ps(_mm_mul_ps(vM00, dx), _mm_mul_ps(vM01, dy));
+		__m128 localY = _mm_add_ps(_mm_mul_ps(vM10, dx), _mm_mul_ps(vM11, dy));
+
+		__m128 depth = _mm_set1_ps(-1.0e30f);
+		__m128 nx = vZero, ny = vZero;
+		for (size_t e = 0; e < numEdges; e++)
+		{
+			__m128 enx = _mm_set1_ps(mEdgeNormals[e].x);
+			__m128 eny = _mm_set1_ps(mEdgeNormals[e].y);
+			__m128 d = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(enx, localX), _mm_mul_ps(eny, localY)), _mm_set1_ps(mEdgeOffsets[e]));
+			d = _mm_sub_ps(d, vRadius);
+
+			__m128 closer = _mm_cmpgt_ps(d, depth);
+			depth = select(closer, d, depth);
+			nx = select(closer, enx, nx);
+			ny = select(closer, eny, ny);
+		}
+
+		// push out along the world space normal and reflect the approaching velocity
+		__m128 inside = _mm_cmplt_ps(depth, vZero);
+		__m128 wnx = _mm_add_ps(_mm_mul_ps(vM00, nx), _mm_mul_ps(vM10, ny));
+		__m128 wny = _mm_add_ps(_mm_mul_ps(vM01, nx), _mm_mul_ps(vM11, ny));
+		__m128 push = _mm_and_ps(inside, depth);
+		px = _mm_sub_ps(px, _mm_mul_ps(push, wnx));
+		py = _mm_sub_ps(py, _mm_mul_ps(push, wny));
+
+		__m128 vn = _mm_add_ps(_mm_mul_ps(vx, wnx), _mm_mul_ps(vy, wny));
+		__m128 impulse = _mm_and_ps(_mm_and_ps(inside, _mm_cmplt_ps(vn, vZero)), _mm_mul_ps(vBounce, vn));
+		__m128 damping = select(inside, vKeep, vOne);
+		vx = _mm_mul_ps(_mm_sub_ps(vx, _mm_mul_ps(impulse, wnx)), damping);
+		vy = _mm_mul_ps(_mm_sub_ps(vy, _mm_mul_ps(impulse, wny)), damping);
+
+		// ground collision
+		__m128 grounded = _mm_cmplt_ps(py, vGround);
+		py = select(grounded, vGround, py);
+		vy = select(_mm_and_ps(grounded, _mm_cmplt_ps(vy, vZero)), _mm_mul_ps(vy, _mm_sub_ps(vZero, vRestitution)), vy);
+		vx = select(grounded, _mm_mul_ps(vx, vKeep), vx);
+
+		// loaded particles take their resting position and stay still
+		_mm_storeu_ps(&mPosX[i], select(released, px, restX));
+		_mm_storeu_ps(&mPosY[i], select(released, py, restY));
+		_mm_storeu_ps(&mVelX[i], _mm_and_ps(released, vx));
+		_mm_storeu_ps(&mVelY[i], _mm_and_ps(released, vy));
+	}
+#else
+	for (unsigned i = begin; i < end; i++)
+	{
+		if (!mReleased[i] && trayAngle >= mReleaseAngle[i])
+			mReleased[i] = ~0u;
+
+		if (!mReleased[i])
+		{
+			mPosX[i] = m00 * mLocalX[i] + m10 * mLocalY[i] + tx;
+			mPosY[i] = m01 * mLocalX[i] + m11 * mLocalY[i] + ty;
+			mVelX[i] = 0.0f;
+			mVelY[i] = 0.0f;
+			continue;
+		}
+
+		float vx = mVelX[i];
+		float vy = mVelY[i] - mGravity * deltaTime;
+		float px = mPosX[i] + vx * deltaTime;
+		float py = mPosY[i] + vy * deltaTime;
+
+		float dx = px - tx, dy = py - ty;
+		float localX = m00 * dx + m01 * dy;
+		float localY = m10 * dx + m11 * dy;
+
+		float depth = -1.0e30f, nx = 0.0f, ny = 0.0f;
+		for (size_t e = 0; e < numEdges; e++)
+		{
+			float d = mEdgeNormals[e].x * localX + mEdgeNormals[e].y * localY - mEdgeOffsets[e] - mRadius;
+			if (d > depth)
+			{
+				depth = d;
+				nx = mEdgeNormals[e].x;
+				ny = mEdgeNormals[e].y;
+			}
+		}
+
+		if (depth < 0.0f)
+		{
+			float wnx = m00 * nx + m10 * ny;
+			float wny = m01 * nx + m11 * ny;
+			px -= depth * wnx;
+			py -= depth * wny;
+
+			float vn = vx * wnx + vy * wny;
+			if (vn < 0.0f)
+			{
+				vx -= (1.0f + mRestitution) * vn * wnx;
+				vy -= (1.0f + mRestitution) * vn * wny;
+			}
+			vx *= keep;
+			vy *= keep;
+		}
+
+		if (py < groundY)
+		{
+			py = groundY;
+			if (vy < 0.0f)
+				vy = -vy * mRestitution;
+			vx *= keep;
+		}
+
+		mPosX[i] = px;
+		mPosY[i] = py;
+		mVelX[i] = vx;
+		mVelY[i] = vy;
+	}
+#endif
+}
+
+void ParticleSystem::upload()
+{
+	if (mVAO == 0)
+	{
+		glGenVertexArrays(1, &mVAO);
+		glGenBuffers(1, &mVBO);
+	}
+
+	// orphan the buffer so the driver does not wait for last frame's draw
+	GLsizeiptr size = sizeof(float) * mCount;
+	glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+	glBufferData(GL_ARRAY_BUFFER, size * 2, nullptr, GL_STREAM_DRAW);
+	if (mCount > 0)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, mPosX.data());
+		glBufferSubData(GL_ARRAY_BUFFER, size, size, mPosY.data());
+	}
+
+	// x and y are separate streams, the y offset moves with the particle count
+	glBindVertexArray(mVAO);
+	glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), reinterpret_cast<void*>(0));
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float), reinterpret_cast<void*>(size));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+}
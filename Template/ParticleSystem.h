@@ -0,0 +1,64 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <cstdint>
+#include <vector>
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+#include "TruckGeometry.h"
+
+// load carried in the tipper tray, simulated as point particles
+// state is stored structure of arrays so the update can work on four particles at a time
+class ParticleSystem
+{
+public:
+	ParticleSystem();
+	~ParticleSystem();
+
+	// set the convex collision polygon in tray space, counter clockwise
+	void setCollider(const std::vector<glm::vec2>& polygon);
+	// refill the tray with a heap of count particles resting on its top edge
+	void reset(unsigned count);
+
+	// step the particles, trayMatrix places the collider in the world and trayAngle (degrees) decides which particles tip out
+	void update(float deltaTime, const glm::mat4& trayMatrix, float trayAngle);
+	// copy positions into the vertex buffer (render thread only)
+	void upload();
+
+	unsigned getCount() const { return mCount; }
+	GLuint getVAO() const { return mVAO; }
+
+	// settings, exposed in the tweak bar
+	unsigned mNumThreads = 4;		// chunks update() is split into, run on the shared worker pool
+	float mRadius = 0.004f;			// collision radius of a particle
+	float mGroundY = GROUND_Y;		// ground height
+	float mGravity = 2.0f;			// downward acceleration
+	float mRestitution = 0.2f;		// bounce on contact
+	float mFriction = 0.05f;		// velocity lost per frame in contact
+
+private:
+	unsigned mCount = 0;			// live particles
+	unsigned mCapacity = 0;			// mCount rounded up to a multiple of 4
+
+	// particle state
+	std::vector<float> mPosX, mPosY;		// world position
+	std::vector<float> mVelX, mVelY;		// world velocity
+	std::vector<float> mLocalX, mLocalY;	// resting position in tray space while still loaded
+	std::vector<float> mReleaseAngle;		// tipper angle at which the particle starts to slide
+	std::vector<std::uint32_t> mReleased;	// all bits set once the particle has left its resting position
+
+	// collider edges in tray space, n.p = offset on the edge
+	std::vector<glm::vec2> mEdgeNormals;
+	std::vector<float> mEdgeOffsets;
+	float mHeapLeft = 0.0f;			// extent of the top edge the heap is piled on
+	float mHeapRight = 0.0f;
+	float mHeapBase = 0.0f;
+
+	GLuint mVBO = 0;				// positions, all x then all y
+	GLuint mVAO = 0;
+
+	// update particles [begin, end), begin and end are multiples of 4
+	void updateRange(unsigned begin, unsigned end, float deltaTime, const glm::mat4& trayMatrix, float trayAngle);
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "RenderQueue.h"
+#include <cstring>
+#include <utility>
+
+void CommandBuffer::draw(std::uint64_t key, const DrawPayload& payload)
+{
+	DrawItem item;
+	item.key = key;
+	item.payload = static_cast<std::uint32_t>(mPayloads.size());
+
+	mItems.push_back(item);
+	mPayloads.push_back(payload);
+}
+
+void CommandBuffer::clear()
+{
+	mItems.clear();
+	mPayloads.clear();
+}
+
+std::uint64_t RenderQueue::makeKey(unsigned layer, GLuint program, GLuint vao, std::uint32_t order)
+{
+	return (static_cast<std::uint64_t>(layer & 0xFF) << 56)
+		| (static_cast<std::uint64_t>(program & 0xFFF) << 44)
+		| (static_cast<std::uint64_t>(vao & 0xFFF) << 32)
+		| order;
+}
+
+void RenderQueue::resize(unsigned numBuffers)
+{
+	mBuffers.resize(numBuffers > 0 ? numBuffers : 1);
+}
+
+void RenderQueue::reset()
+{
+	for (CommandBuffer& buffer : mBuffers)
+	{
+		buffer.clear();
+	}
+}
+
+void RenderQueue::sort()
+{
+	// merge every command buffer into one item list and one payload arena
+	size_t total = 0;
+	for (const CommandBuffer& buffer : mBuffers)
+	{
+		total += buffer.mItems.size();
+	}
+
+	mItems.resize(total);
+	mScratch.resize(total);
+	mPayloads.resize(total);
+
+	size_t base = 0;
+	for (const CommandBuffer& buffer : mBuffers)
+	{
+		size_t count = buffer.mItems.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			// rebase the payload offset into the merged arena
+			mItems[base + i].key = buffer.mItems[i].key;
+			mItems[base + i].payload = static_cast<std::uint32_t>(base) + buffer.mItems[i].payload;
+		}
+		if (count > 0)
+		{
+			std::memcpy(&mPayloads[base], buffer.mPayloads.data(), sizeof(DrawPayload) * count);
+		}
+		base += count;
+	}
+
+	// least significant digit radix sort, 8 bits per pass, stable so equal keys keep record order
+	DrawItem* src = mItems.data();
+	DrawItem* dst = mScratch.data();
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = { 0 };
+		for (size_t i = 0; i < total; i++)
+		{
+			histogram[(src[i].key >> shift) & 0xFF]++;
+		}
+
+		// skip the pass if every key has the same digit, common for the layer/program/vao bytes
+		if (total == 0 || histogram[(src[0].key >> shift) & 0xFF] == total)
+		{
+			continue;
+		}
+
+		// prefix sum gives the start of each bucket
+		size_t offset = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			size_t count = histogram[b];
+			histogram[b] = offset;
+			offset += count;
+		}
+
+		for (size_t i = 0; i < total; i++)
+		{
+			dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+		}
+
+		std::swap(src, dst);
+	}
+
+	// make sure the sorted result ends up in mItems
+	if (src != mItems.data())
+	{
+		mItems.swap(mScratch);
+	}
+}
+
+void RenderQueue::execute()
+{
+	ShaderProgram* currentShader = nullptr;
+	GLuint currentVAO = 0;
+	const glm::mat4* currentMatrix = nullptr;
+	mStateChanges = 0;
+
+	for (const DrawItem& item : mItems)
+	{
+		const DrawPayload& payload = mPayloads[item.payload];
+
+		// only change program when it differs, a new program also needs its matrix set again
+		if (payload.shader != currentShader)
+		{
+			currentShader = payload.shader;
+			currentShader->use();
+			currentMatrix = nullptr;
+			mStateChanges++;
+		}
+
+		if (payload.vao != currentVAO)
+		{
+			currentVAO = payload.vao;
+			glBindVertexArray(currentVAO);
+			mStateChanges++;
+		}
+
+		if (currentMatrix == nullptr || std::memcmp(currentMatrix, &payload.modelMatrix, sizeof(glm::mat4)) != 0)
+		{
+			currentMatrix = &payload.modelMatrix;
+			currentShader->setUniform("uModelMatrix", payload.modelMatrix);
+			mStateChanges++;
+		}
+
+		glDrawArrays(payload.mode, payload.first, payload.count);
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+#include "ShaderProgram.h"
+
+// render layers, drawn back to front
+// layers are the only ordering barrier; within a layer items are grouped by state then order
+enum RenderLayer
+{
+	LAYER_BACKGROUND = 0,
+	LAYER_SCENE,
+	LAYER_EFFECTS,
+	LAYER_OVERLAY
+};
+
+// data a draw needs at execute time, stored in the per-frame payload arena
+struct DrawPayload
+{
+	glm::mat4 modelMatrix;		// value for uModelMatrix
+	ShaderProgram* shader;		// program to draw with
+	GLuint vao;					// vertex array to draw from
+	GLenum mode;				// primitive type
+	GLint first;				// first vertex
+	GLsizei count;				// number of vertices
+};
+
+// compact draw item, only the key and offset are moved while sorting
+struct DrawItem
+{
+	std::uint64_t key;			// sort key, see RenderQueue::makeKey
+	std::uint32_t payload;		// offset into the payload arena
+};
+
+// per-thread list of draw items
+// a command buffer must only be recorded by one thread at a time
+class CommandBuffer
+{
+public:
+	// record a draw with a key made by RenderQueue::makeKey
+	void draw(std::uint64_t key, const DrawPayload& payload);
+	// number of recorded draws
+	size_t size() const { return mItems.size(); }
+	// forget all recorded draws, keeps allocations
+	void clear();
+
+private:
+	friend class RenderQueue;
+
+	std::vector<DrawItem> mItems;			// draws recorded this frame
+	std::vector<DrawPayload> mPayloads;		// this buffer's payload arena
+};
+
+// collects command buffers from any number of threads, sorts them and issues them on the render thread
+class RenderQueue
+{
+public:
+	// sort key layout, most significant bits first
+	// layer (8) | program (12) | vao (12) | order (32)
+	static std::uint64_t makeKey(unsigned layer, GLuint program, GLuint vao, std::uint32_t order);
+
+	// set the number of command buffers, do not call while threads are recording
+	void resize(unsigned numBuffers);
+	// command buffer owned by one recording thread
+	CommandBuffer& getCommandBuffer(unsigned index) { return mBuffers[index]; }
+	unsigned getNumBuffers() const { return static_cast<unsigned>(mBuffers.size()); }
+
+	// clear all command buffers, call before recording a new frame
+	void reset();
+	// merge the command buffers and radix sort the draws, call after all threads finished recording
+	void sort();
+	// issue the sorted draws with redundant state changes removed (render thread only)
+	void execute();
+
+	// sorted draws and their payloads, valid after sort() until the next reset()
+	const std::vector<DrawItem>& getItems() const { return mItems; }
+	const DrawPayload& getPayload(const DrawItem& item) const { return mPayloads[item.payload]; }
+
+	// stats for the last executed frame
+	size_t getDrawCount() const { return mItems.size(); }
+	unsigned getStateChanges() const { return mStateChanges; }
+
+private:
+	std::vector<CommandBuffer> mBuffers = std::vector<CommandBuffer>(1);
+	std::vector<DrawItem> mItems;			// merged draws
+	std::vector<DrawItem> mScratch;			// radix sort ping-pong buffer
+	std::vector<DrawPayload> mPayloads;		// merged payload arena
+	unsigned mStateChanges = 0;				// program/vao/matrix changes issued by execute()
+};
+
+#endif
@@ -0,0 +1,16 @@
+#include "Renderer.h"
+
+void GLRenderer::render(RenderQueue& queue, const glm::vec3& clearColour, int width, int height)
+{
+	// draw into the bottom left width x height of the bound framebuffer, the same frame the software backend fills
+	glViewport(0, 0, width, height);
+
+	// clear color buffer
+	glClearColor(clearColour.r, clearColour.g, clearColour.b, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	queue.execute();
+
+	// flush the graphics pipeline
+	glFlush();
+}
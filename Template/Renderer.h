@@ -0,0 +1,27 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <glm/glm.hpp>
+#include "RenderQueue.h"
+
+// backend that turns a sorted render queue into pixels
+class Renderer
+{
+public:
+	virtual ~Renderer() {}
+
+	// clear to clearColour and draw the queue into a width x height target
+	virtual void render(RenderQueue& queue, const glm::vec3& clearColour, int width, int height) = 0;
+	// name shown in the UI
+	virtual const char* getName() const = 0;
+};
+
+// draws through OpenGL into the currently bound framebuffer
+class GLRenderer : public Renderer
+{
+public:
+	void render(RenderQueue& queue, const glm::vec3& clearColour, int width, int height) override;
+	const char* getName() const override { return "OpenGL"; }
+};
+
+#endif
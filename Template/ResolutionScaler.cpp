@@ -0,0 +1,186 @@
+#include "ResolutionScaler.h"
+#include "CpuSupport.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// frames to average after a scale change before judging it, the old render times say nothing about the new scale
+static const unsigned SETTLE_FRAMES = 15;
+// largest scale increase per change, raising costs fill rate before the average can show it
+static const float MAX_SCALE_STEP = 0.1f;
+
+ResolutionScaler::ResolutionScaler()
+{}
+
+ResolutionScaler::~ResolutionScaler()
+{
+	release();
+	if (mQueries[0] != 0)
+		glDeleteQueries(QUERY_COUNT, mQueries);
+}
+
+void ResolutionScaler::release()
+{
+	if (mFBO != 0)
+	{
+		glDeleteFramebuffers(1, &mFBO);
+		mFBO = 0;
+	}
+	if (mColourTex != 0)
+	{
+		glDeleteTextures(1, &mColourTex);
+		mColourTex = 0;
+	}
+}
+
+void ResolutionScaler::resize(int width, int height)
+{
+	// minimised windows report a zero size, keep the old target
+	if (width <= 0 || height <= 0)
+		return;
+
+	release();
+
+	mWidth = width;
+	mHeight = height;
+	mUnavailable = false;
+
+	// the target is allocated at full size, lower scales only use its bottom left corner
+	glGenTextures(1, &mColourTex);
+	glBindTexture(GL_TEXTURE_2D, mColourTex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &mFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mColourTex, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		// fall back to rendering at native resolution, kept apart from mEnabled so the tweak bar cannot turn it back on
+		std::cerr << "Failed to create scaled render target" << std::endl;
+		mUnavailable = true;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ResolutionScaler::update()
+{
+	// read the finished queries oldest first, the slot about to be reused holds the oldest one
+	for (unsigned i = 0; i < QUERY_COUNT; ++i)
+	{
+		unsigned slot = (mQueryNext + i) % QUERY_COUNT;
+		if (!mQueryPending[slot])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(mQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+
+		GLuint64 gpuNs = 0;
+		glGetQueryObjectui64v(mQueries[slot], GL_QUERY_RESULT, &gpuNs);
+		mQueryPending[slot] = false;
+
+		// the frame costs whichever of submitting and drawing it takes longer
+		adjust(std::max(static_cast<double>(mQueryCpuMs[slot]), gpuNs / 1.0e6));
+	}
+}
+
+void ResolutionScaler::adjust(double renderTimeMs)
+{
+	// ignore stalls such as the first frame or a window drag, they say nothing about fill rate
+	if (renderTimeMs > 250.0)
+		return;
+
+	if (!mEnabled || mUnavailable)
+	{
+		mScale = 1.0f;
+		mSmoothedFrameTime = 0.0;
+		mSettleFrames = 0;
+		return;
+	}
+
+	// smooth out single slow frames so the scale does not flicker
+	if (mSettleFrames == 0)
+		mSmoothedFrameTime = renderTimeMs;
+	else
+		mSmoothedFrameTime += (renderTimeMs - mSmoothedFrameTime) * 0.1;
+
+	// the average only describes the current scale once it has seen enough frames rendered at it
+	if (++mSettleFrames < SETTLE_FRAMES)
+		return;
+
+	// fill cost grows with the square of the scale, so correct by the square root of the ratio
+	// fixed per frame costs make this undercorrect, so it approaches the target from one side without overshooting
+	// nothing changes inside the band so the scale does not hunt around the target
+	float scale = mScale;
+	if (mSmoothedFrameTime > mTargetFrameTimeMs * 1.1 || mSmoothedFrameTime < mTargetFrameTimeMs * 0.9)
+	{
+		scale *= static_cast<float>(std::sqrt(mTargetFrameTimeMs / mSmoothedFrameTime));
+		if (scale > mScale + MAX_SCALE_STEP) scale = mScale + MAX_SCALE_STEP;
+	}
+
+	if (scale < mMinScale) scale = mMinScale;
+	if (scale > mMaxScale) scale = mMaxScale;
+
+	// start a fresh average at the new scale
+	if (scale != mScale)
+	{
+		mScale = scale;
+		mSettleFrames = 0;
+	}
+}
+
+void ResolutionScaler::begin()
+{
+	// time every frame, also at full scale, so the controller can tell when there is room to scale back up
+	if (mQueries[0] == 0)
+		glGenQueries(QUERY_COUNT, mQueries);
+	// skip timing while the slot's last result is still in flight rather than wait for the gpu
+	mTiming = !mQueryPending[mQueryNext];
+	if (mTiming)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, mQueries[mQueryNext]);
+		mBeginTime = std::chrono::steady_clock::now();
+	}
+
+	mActive = mEnabled && !mUnavailable && mFBO != 0 && mScale < 1.0f;
+	if (!mActive)
+		return;
+
+	mScaledWidth = static_cast<int>(mWidth * mScale);
+	mScaledHeight = static_cast<int>(mHeight * mScale);
+	if (mScaledWidth < 1) mScaledWidth = 1;
+	if (mScaledHeight < 1) mScaledHeight = 1;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glViewport(0, 0, mScaledWidth, mScaledHeight);
+}
+
+void ResolutionScaler::end()
+{
+	if (mActive)
+	{
+		// stretch the rendered corner over the whole window
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, mFBO);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, mScaledWidth, mScaledHeight, 0, 0, mWidth, mHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, mWidth, mHeight);
+		mActive = false;
+	}
+
+	if (mTiming)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		mQueryCpuMs[mQueryNext] = elapsed_ms(mBeginTime);
+		mQueryPending[mQueryNext] = true;
+		mQueryNext = (mQueryNext + 1) % QUERY_COUNT;
+		mTiming = false;
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef RESOLUTION_SCALER_H
+#define RESOLUTION_SCALER_H
+
+#include <GLEW/glew.h>
+#include <chrono>
+
+// renders the scene into an offscreen target at a fraction of the window size and upscales it
+// the scale is adjusted to hold a render time target, waiting for the render time to settle after each change
+// render time is measured between begin() and end() so the vsync wait in the swap does not count against it
+class ResolutionScaler
+{
+public:
+	ResolutionScaler();
+	~ResolutionScaler();
+
+	// create the render target for a window size, call again when the window is resized
+	void resize(int width, int height);
+	// adjust the scale from the render times of earlier frames whose timer queries have finished
+	void update();
+
+	// redirect rendering into the scaled render target
+	void begin();
+	// upscale the render target into the default framebuffer and restore the full viewport
+	void end();
+
+	float getScale() const { return mScale; }
+	// false when the render target could not be created, scaled rendering then stays off whatever mEnabled says
+	bool isAvailable() const { return !mUnavailable; }
+
+	// settings, exposed in the tweak bar
+	bool mEnabled = true;				// false renders straight to the default framebuffer
+	float mTargetFrameTimeMs = 16.7f;	// render time to hold
+	float mMinScale = 0.25f;			// lowest scale the controller may pick
+	float mMaxScale = 1.0f;				// highest scale the controller may pick
+
+private:
+	GLuint mFBO = 0;			// framebuffer object identifier
+	GLuint mColourTex = 0;		// colour attachment
+	int mWidth = 0;				// window size
+	int mHeight = 0;
+	int mScaledWidth = 0;		// size rendered at this frame
+	int mScaledHeight = 0;
+	float mScale = 1.0f;		// current scale factor per axis
+	double mSmoothedFrameTime = 0.0;	// moving average of the render time in ms since the last scale change
+	unsigned mSettleFrames = 0;	// frames averaged since the last scale change
+	bool mUnavailable = false;	// the render target is incomplete
+	bool mActive = false;		// true between begin() and end()
+
+	// render timing, the gpu result arrives a few frames late so the queries are used round robin
+	static const unsigned QUERY_COUNT = 4;
+	GLuint mQueries[QUERY_COUNT] = {};		// GL_TIME_ELAPSED queries
+	float mQueryCpuMs[QUERY_COUNT] = {};	// cpu time spent submitting the frame timed by each query
+	bool mQueryPending[QUERY_COUNT] = {};	// query ended but its result not read yet
+	unsigned mQueryNext = 0;				// slot the next frame is timed with
+	bool mTiming = false;					// a query was begun this frame
+	std::chrono::steady_clock::time_point mBeginTime;
+
+	void release();
+	void adjust(double renderTimeMs);
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "ResourceLoader.h"
+#include <chrono>
+#include <utility>
+#include <iostream>
+
+ResourceLoader::~ResourceLoader()
+{
+	stop();
+}
+
+void ResourceLoader::start(GLFWwindow* shareWindow)
+{
+	// hidden 1x1 window sharing objects with the main context, same context hints as the main window
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	mContext = glfwCreateWindow(1, 1, "Loader", nullptr, shareWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (mContext == nullptr)
+	{
+		std::cerr << "Failed to create loader context, loading on the render thread" << std::endl;
+		return;
+	}
+
+	mStop = false;
+	mThread = std::thread(&ResourceLoader::run, this);
+}
+
+void ResourceLoader::stop()
+{
+	if (mThread.joinable())
+	{
+		mStop = true;
+		mWake.notify_one();
+		mThread.join();
+	}
+
+	// the loader has gone, drop what it never got to and delete uploads the render thread never received
+	// the main context shares objects with the loader's, so the buffers and fences can be deleted from here
+	while (mRequests.front() != nullptr)
+		mRequests.pop();
+	while (Upload* upload = mUploads.front())
+	{
+		release(*upload);
+		mUploads.pop();
+	}
+
+	if (mContext != nullptr)
+	{
+		glfwDestroyWindow(mContext);
+		mContext = nullptr;
+	}
+}
+
+bool ResourceLoader::requestMesh(const std::string& name, MeshBuilder build, MeshCallback onLoaded)
+{
+	Request request;
+	request.name = name;
+	request.build = build;
+	request.onLoaded = onLoaded;
+
+	if (!mRequests.push(std::move(request)))
+		return false;
+
+	// notify without the mutex, a missed wake up only costs the loader's poll interval
+	mWake.notify_one();
+	return true;
+}
+
+void ResourceLoader::poll()
+{
+	// no loader thread, do the work here
+	if (mContext == nullptr)
+	{
+		while (Request* request = mRequests.front())
+		{
+			Upload upload = load(*request);
+			mRequests.pop();
+			glDeleteSync(upload.fence);
+			upload.onLoaded(upload.mesh);
+		}
+		return;
+	}
+
+	// uploads finish in order, stop at the first one still in flight
+	while (Upload* upload = mUploads.front())
+	{
+		GLenum status = glClientWaitSync(upload->fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED)
+			break;
+
+		if (status == GL_WAIT_FAILED)
+			std::cerr << "Fence wait failed for " << upload->mesh.name << std::endl;
+
+		glDeleteSync(upload->fence);
+		upload->onLoaded(upload->mesh);
+		mUploads.pop();
+	}
+}
+
+void ResourceLoader::run()
+{
+	glfwMakeContextCurrent(mContext);
+
+	while (!mStop)
+	{
+		Request* request = mRequests.front();
+		if (request == nullptr)
+		{
+			// idle, sleep until a request arrives
+			std::unique_lock<std::mutex> lock(mWakeMutex);
+			mWake.wait_for(lock, std::chrono::milliseconds(10));
+			continue;
+		}
+
+		Upload upload = load(*request);
+		mRequests.pop();
+
+		// the render thread drains this every frame, so a full queue clears quickly
+		bool queued = false;
+		while (!(queued = mUploads.push(std::move(upload))) && !mStop)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		// stopped while the queue was full, nobody will receive this one
+		if (!queued)
+			release(upload);
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+ResourceLoader::Upload ResourceLoader::load(Request& request)
+{
+	// build the vertex data, this is where file I/O and generation happen
+	std::vector<GLfloat> vertices = request.build();
+
+	Upload upload;
+	upload.mesh.name = request.name;
+	upload.mesh.size = static_cast<GLsizeiptr>(sizeof(GLfloat) * vertices.size());
+	upload.onLoaded = request.onLoaded;
+
+	// create VBO and buffer the data
+	glGenBuffers(1, &upload.mesh.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, upload.mesh.vbo);
+	glBufferData(GL_ARRAY_BUFFER, upload.mesh.size, vertices.empty() ? nullptr : vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	upload.mesh.vertices = std::move(vertices);
+
+	// the fence must be flushed or the other context could wait on it forever
+	upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	return upload;
+}
+
+void ResourceLoader::release(Upload& upload)
+{
+	if (upload.fence != nullptr)
+	{
+		glDeleteSync(upload.fence);
+		upload.fence = nullptr;
+	}
+	if (upload.mesh.vbo != 0)
+	{
+		glDeleteBuffers(1, &upload.mesh.vbo);
+		upload.mesh.vbo = 0;
+	}
+}
@@ -0,0 +1,76 @@
+#ifndef RESOURCE_LOADER_H
+#define RESOURCE_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GLEW/glew.h>
+#include <GLFW/glfw3.h>
+#include "SpscQueue.h"
+
+// vertex buffer uploaded by the loader, ready to use on the render thread
+struct MeshResource
+{
+	std::string name;
+	GLuint vbo = 0;				// buffer in the shared context, owned by the receiver
+	GLsizeiptr size = 0;		// size of the buffer in bytes
+	std::vector<GLfloat> vertices;	// CPU copy of the buffer, for the software renderer
+};
+
+// builds and uploads meshes on a thread with its own shared GL context
+// finished uploads are handed back through a lock-free queue and only used once their fence has signalled
+class ResourceLoader
+{
+public:
+	// produces the vertex data for a mesh, runs on the loader thread
+	typedef std::function<std::vector<GLfloat>()> MeshBuilder;
+	// receives a finished mesh, runs on the render thread inside poll()
+	typedef std::function<void(const MeshResource&)> MeshCallback;
+
+	~ResourceLoader();
+
+	// create the shared context and start the loader thread (main thread only)
+	// if no shared context can be made, requests are built and uploaded inside poll() instead
+	void start(GLFWwindow* shareWindow);
+	// stop the loader thread and destroy its context, uploads nobody received are deleted (main thread only)
+	void stop();
+
+	// queue a mesh to build, returns false if the request queue is full (render thread only)
+	bool requestMesh(const std::string& name, MeshBuilder build, MeshCallback onLoaded);
+	// hand over uploads whose fence has signalled, never waits (render thread only)
+	void poll();
+
+private:
+	struct Request
+	{
+		std::string name;
+		MeshBuilder build;
+		MeshCallback onLoaded;
+	};
+
+	struct Upload
+	{
+		MeshResource mesh;
+		GLsync fence = nullptr;		// signals once the upload has reached the GPU
+		MeshCallback onLoaded;
+	};
+
+	GLFWwindow* mContext = nullptr;		// hidden window owning the shared context
+	std::thread mThread;
+	std::atomic<bool> mStop{ false };
+	std::mutex mWakeMutex;				// only used to sleep the loader while idle
+	std::condition_variable mWake;
+
+	SpscQueue<Request, 64> mRequests;	// render thread to loader
+	SpscQueue<Upload, 64> mUploads;		// loader to render thread
+
+	void run();
+	Upload load(Request& request);
+	static void release(Upload& upload);
+};
+
+#endif
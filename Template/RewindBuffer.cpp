@@ -0,0 +1,451 @@
+#include "RewindBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// snapshot words per truck: x, wheel angle, tray angle
+	const unsigned WORDS_PER_TRUCK = 3;
+
+	// fixed point steps, far below a pixel and a visible rotation
+	// x covers +-2^31 / X_STEPS = +-524288 units, trucks spawn within 0.6 units per truck of the origin,
+	// so the largest fleet the tweak bar allows (200000 trucks, about +-120000 units) stays well inside it
+	const double X_STEPS = 4096.0;				// per unit of road, a tenth of a pixel at 800 pixels across
+	const double X_LIMIT = 2147483647.0 / X_STEPS;
+	const double WHEEL_STEPS = 1048576.0;		// per turn, the word wraps after a whole number of turns
+	const double TRAY_STEPS = 256.0;			// per degree
+	const double TWO_PI = 6.283185307179586;
+
+	// bytes stored for each 2 bit tag
+	const unsigned TAG_BYTES[4] = { 0, 1, 2, 4 };
+
+	// position and wheel angle change at a steady rate between collisions, so they continue the last step
+	// the tray sits still for long stretches, so it repeats the last value
+	const unsigned WORD_MAX_ORDER[WORDS_PER_TRUCK] = { 2, 2, 1 };
+
+	// words are stored as unsigned so the prediction arithmetic wraps instead of overflowing
+	std::uint32_t quantise(double value, double steps)
+	{
+		return static_cast<std::uint32_t>(std::llround(value * steps));
+	}
+
+	double dequantise(std::uint32_t word, double steps)
+	{
+		return static_cast<std::int32_t>(word) / steps;
+	}
+
+	// order 0 predicts zero, 1 the previous word, 2 the previous word plus the last step
+	std::uint32_t predict(size_t i, unsigned order, const std::uint32_t* previous, const std::uint32_t* previous2)
+	{
+		order = std::min(order, WORD_MAX_ORDER[i % WORDS_PER_TRUCK]);
+		if (order == 0)
+			return 0;
+		if (order == 1)
+			return previous[i];
+		return previous[i] + (previous[i] - previous2[i]);
+	}
+
+	// pack the difference of each word to its prediction, small differences of either sign take few bytes
+	// layout: one 2 bit tag per word (4 per byte), then the low bytes of every non zero difference
+	void encode(const std::uint32_t* current, const std::uint32_t* previous, const std::uint32_t* previous2, size_t numWords, unsigned order, std::vector<std::uint8_t>& out)
+	{
+		size_t numTagBytes = (numWords + 3) / 4;
+		out.assign(numTagBytes, 0);
+
+		for (size_t i = 0; i < numWords; i++)
+		{
+			std::uint32_t difference = current[i] - predict(i, order, previous, previous2);
+			std::uint32_t word = (difference << 1) ^ static_cast<std::uint32_t>(static_cast<std::int32_t>(difference) >> 31);
+
+			unsigned tag;
+			if (word == 0) tag = 0;
+			else if (word <= 0xFF) tag = 1;
+			else if (word <= 0xFFFF) tag = 2;
+			else tag = 3;
+
+			out[i / 4] |= static_cast<std::uint8_t>(tag << ((i % 4) * 2));
+			for (unsigned b = 0; b < TAG_BYTES[tag]; b++)
+				out.push_back(static_cast<std::uint8_t>(word >> (b * 8)));
+		}
+	}
+
+	// undo encode, returns the size of the frame
+	size_t decode(const std::uint8_t* data, size_t numWords, unsigned order, const std::uint32_t* previous, const std::uint32_t* previous2, std::uint32_t* words)
+	{
+		const std::uint8_t* payload = data + (numWords + 3) / 4;
+
+		for (size_t i = 0; i < numWords; i++)
+		{
+			unsigned tag = (data[i / 4] >> ((i % 4) * 2)) & 3;
+
+			std::uint32_t word = 0;
+			for (unsigned b = 0; b < TAG_BYTES[tag]; b++)
+				word |= static_cast<std::uint32_t>(*payload++) << (b * 8);
+
+			std::uint32_t difference = (word >> 1) ^ (0u - (word & 1));
+			words[i] = predict(i, order, previous, previous2) + difference;
+		}
+		return static_cast<size_t>(payload - data);
+	}
+}
+
+RewindBuffer::RewindBuffer(size_t budgetBytes, unsigned maxKeyframeInterval)
+{
+	configure(budgetBytes, maxKeyframeInterval);
+}
+
+RewindBuffer::~RewindBuffer()
+{
+	// the encoder writes into this object
+	if (mEncoder.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mEncodeMutex);
+			mStopEncoder = true;
+		}
+		mEncodeWake.notify_all();
+		mEncoder.join();
+	}
+}
+
+void RewindBuffer::configure(size_t budgetBytes, unsigned maxKeyframeInterval)
+{
+	clear();
+	// the index stores frame sizes in 31 bits
+	mBudget = std::min<size_t>(budgetBytes, 0x7FFFFFFFu);
+	mMaxKeyframeInterval = std::max(1u, maxKeyframeInterval);
+
+	// the rings are split for the fleet size when the next history starts
+	std::vector<std::uint8_t>().swap(mData);
+	std::vector<Frame>().swap(mIndex);
+}
+
+void RewindBuffer::layout(size_t numWords)
+{
+	// every frame holds at least its tags, so give the index as many slots as such frames fit in the rest
+	// a fleet moving steadily writes frames close to that size, larger frames leave some slots unused
+	size_t smallestFrame = (numWords + 3) / 4;
+	size_t numSlots = mBudget / (smallestFrame + sizeof(Frame));
+	size_t dataBytes = mBudget - numSlots * sizeof(Frame);
+
+	// swapped rather than resized so a smaller ring also gives its memory back
+	if (mIndex.size() != numSlots)
+		std::vector<Frame>(numSlots).swap(mIndex);
+	if (mData.size() != dataBytes)
+		std::vector<std::uint8_t>(dataBytes).swap(mData);
+}
+
+void RewindBuffer::clear()
+{
+	// drop the frame being encoded
+	{
+		std::unique_lock<std::mutex> lock(mEncodeMutex);
+		mEncodeWake.wait(lock, [this]() { return !mEncodeBusy; });
+	}
+	mEncodePending = false;
+
+	mFirstFrame = 0;
+	mNumFrames = 0;
+	mUsedBytes = 0;
+	mWrite = 0;
+	mSinceKeyframe = 0;
+	mNumTrucks = 0;
+}
+
+void RewindBuffer::record(std::uint64_t tick, const std::vector<Truck>& trucks)
+{
+	// the encoder is still on the last tick, keep the render thread going and skip this one
+	if (encoderBusy())
+		return;
+	commit();
+
+	// a respawned fleet is a new history
+	if (trucks.size() != mNumTrucks || mIndex.empty() || (!empty() && tick <= getNewestTick()))
+	{
+		clear();
+		mNumTrucks = static_cast<unsigned>(trucks.size());
+
+		size_t numWords = trucks.size() * WORDS_PER_TRUCK;
+		layout(numWords);
+
+		// a delta can be as large as a keyframe, keep a whole group within half the ring
+		// so writing one never evicts its own keyframe and a complete group is left to seek in
+		size_t largestFrame = (numWords + 3) / 4 + numWords * 4;
+		size_t fitting = largestFrame > 0 ? mData.size() / (2 * largestFrame) : mMaxKeyframeInterval;
+		mKeyframeInterval = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(fitting, mMaxKeyframeInterval)));
+	}
+
+	bool keyframe = empty() || mSinceKeyframe + 1 >= mKeyframeInterval;
+	unsigned order = keyframe ? 0 : (mSinceKeyframe == 0 ? 1 : 2);
+
+	// the copy is all the render thread pays for, quantising and packing happen on the encoder
+	mSnapshot.assign(trucks.begin(), trucks.end());
+	mEncodeTick = tick;
+	mEncodeOrder = order;
+	mEncodePending = true;
+
+	if (!mEncoder.joinable())
+		mEncoder = std::thread(&RewindBuffer::runEncoder, this);
+	{
+		std::lock_guard<std::mutex> lock(mEncodeMutex);
+		mEncodeBusy = true;
+	}
+	mEncodeWake.notify_all();
+}
+
+void RewindBuffer::runEncoder()
+{
+	std::unique_lock<std::mutex> lock(mEncodeMutex);
+	for (;;)
+	{
+		mEncodeWake.wait(lock, [this]() { return mEncodeBusy || mStopEncoder; });
+		if (mStopEncoder)
+			return;
+
+		// the render thread leaves the snapshot and the encoder state alone until mEncodeBusy is cleared
+		lock.unlock();
+		encodeSnapshot(mEncodeOrder);
+		lock.lock();
+
+		mEncodeBusy = false;
+		mEncodeWake.notify_all();
+	}
+}
+
+bool RewindBuffer::encoderBusy()
+{
+	std::lock_guard<std::mutex> lock(mEncodeMutex);
+	return mEncodeBusy;
+}
+
+void RewindBuffer::encodeSnapshot(unsigned order)
+{
+	size_t numWords = mSnapshot.size() * WORDS_PER_TRUCK;
+	mCurrent.resize(numWords);
+	for (size_t i = 0; i < mSnapshot.size(); i++)
+	{
+		// outside the range the word wraps and the truck would decode on the other side of the road
+		assert(std::fabs(mSnapshot[i].x) < X_LIMIT);
+		mCurrent[i * WORDS_PER_TRUCK + 0] = quantise(mSnapshot[i].x, X_STEPS);
+		assert(std::fabs(dequantise(mCurrent[i * WORDS_PER_TRUCK + 0], X_STEPS) - mSnapshot[i].x) <= 1.0 / X_STEPS);
+		mCurrent[i * WORDS_PER_TRUCK + 1] = quantise(mSnapshot[i].wheelAngle / TWO_PI, WHEEL_STEPS);
+		mCurrent[i * WORDS_PER_TRUCK + 2] = quantise(mSnapshot[i].trayAngle, TRAY_STEPS);
+	}
+
+	encode(mCurrent.data(), mPrevious.data(), mPrevious2.data(), numWords, order, mEncoded);
+}
+
+void RewindBuffer::flush()
+{
+	{
+		std::unique_lock<std::mutex> lock(mEncodeMutex);
+		mEncodeWake.wait(lock, [this]() { return !mEncodeBusy; });
+	}
+	commit();
+}
+
+void RewindBuffer::commit()
+{
+	// only called while the encoder is idle
+	if (!mEncodePending)
+		return;
+	mEncodePending = false;
+
+	// the frame would not fit even in an empty ring
+	if (mIndex.empty() || mEncoded.size() > mData.size())
+	{
+		clear();
+		return;
+	}
+
+	size_t offset = allocate(mEncoded.size());
+
+	// making room dropped the keyframe this delta depends on, store it as a keyframe instead
+	unsigned order = mEncodeOrder;
+	if (order != 0 && empty())
+	{
+		order = 0;
+		encode(mCurrent.data(), nullptr, nullptr, mCurrent.size(), order, mEncoded);
+		if (mEncoded.size() > mData.size())
+		{
+			clear();
+			return;
+		}
+		offset = allocate(mEncoded.size());
+	}
+
+	std::memcpy(&mData[offset], mEncoded.data(), mEncoded.size());
+
+	Frame& added = mIndex[(mFirstFrame + mNumFrames) % mIndex.size()];
+	added.tick = mEncodeTick;
+	added.offset = static_cast<std::uint32_t>(offset);
+	added.size = static_cast<std::uint32_t>(mEncoded.size());
+	added.keyframe = order == 0;
+	mNumFrames++;
+	mUsedBytes += added.size + sizeof(Frame);
+
+	mSinceKeyframe = added.keyframe ? 0 : mSinceKeyframe + 1;
+	mPrevious2.swap(mPrevious);
+	mPrevious.swap(mCurrent);
+}
+
+size_t RewindBuffer::allocate(size_t size)
+{
+	// the index is full when the frames are smaller than the split assumed
+	if (mNumFrames == mIndex.size())
+		evictGroup();
+
+	if (empty())
+		mWrite = 0;
+
+	size_t offset = mWrite;
+	if (offset + size > mData.size())
+	{
+		// no room before the end, the frames in the tail are the oldest so drop them and wrap
+		while (!empty() && frame(0).offset >= mWrite)
+			evictGroup();
+		offset = 0;
+	}
+
+	// drop the oldest frames the new one would overwrite
+	while (!empty() && frame(0).offset >= offset && frame(0).offset < offset + size)
+		evictGroup();
+
+	mWrite = offset + size;
+	return offset;
+}
+
+void RewindBuffer::evictGroup()
+{
+	// deltas are useless without their keyframe, so drop up to the next keyframe
+	do
+	{
+		mUsedBytes -= frame(0).size + sizeof(Frame);
+		mFirstFrame = (mFirstFrame + 1) % mIndex.size();
+		mNumFrames--;
+	} while (!empty() && !frame(0).keyframe);
+}
+
+bool RewindBuffer::buildSeekJob(std::uint64_t tick, SeekJob& job) const
+{
+	if (empty() || tick < getOldestTick())
+		return false;
+
+	// newest frame at or before tick, the first frame after it lies in [low, high]
+	size_t low = 0, high = mNumFrames;
+	while (low < high)
+	{
+		size_t mid = (low + high) / 2;
+		if (frame(mid).tick <= tick)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	size_t last = low - 1;
+
+	// back to its keyframe, at most one interval away
+	size_t first = last;
+	while (!frame(first).keyframe)
+		first--;
+
+	job.tick = frame(last).tick;
+	job.numTrucks = mNumTrucks;
+	job.sizes.clear();
+	job.data.clear();
+	for (size_t i = first; i <= last; i++)
+	{
+		const Frame& f = frame(i);
+		job.sizes.push_back(f.size);
+		job.data.insert(job.data.end(), mData.begin() + f.offset, mData.begin() + f.offset + f.size);
+	}
+
+	return true;
+}
+
+RewindBuffer::SeekResult RewindBuffer::runSeekJob(const SeekJob& job)
+{
+	size_t numWords = static_cast<size_t>(job.numTrucks) * WORDS_PER_TRUCK;
+	std::vector<std::uint32_t> words(numWords, 0), previous(numWords, 0), previous2(numWords, 0);
+
+	// frames predict from the ones before them in the same group, the same way they were encoded
+	const std::uint8_t* data = job.data.data();
+	for (size_t i = 0; i < job.sizes.size(); i++)
+	{
+		previous2.swap(previous);
+		previous.swap(words);
+		decode(data, numWords, static_cast<unsigned>(std::min<size_t>(i, 2)), previous.data(), previous2.data(), words.data());
+		data += job.sizes[i];
+	}
+
+	SeekResult result;
+	result.tick = job.tick;
+	result.trucks.resize(job.numTrucks);
+	for (size_t i = 0; i < job.numTrucks; i++)
+	{
+		result.trucks[i].x = static_cast<float>(dequantise(words[i * WORDS_PER_TRUCK + 0], X_STEPS));
+		result.trucks[i].wheelAngle = static_cast<float>(dequantise(words[i * WORDS_PER_TRUCK + 1], WHEEL_STEPS) * TWO_PI);
+		result.trucks[i].trayAngle = static_cast<float>(dequantise(words[i * WORDS_PER_TRUCK + 2], TRAY_STEPS));
+	}
+	return result;
+}
+
+bool RewindBuffer::seek(std::uint64_t tick, std::vector<Truck>& trucks, std::uint64_t& foundTick) const
+{
+	SeekJob job;
+	if (!buildSeekJob(tick, job))
+		return false;
+
+	SeekResult result = runSeekJob(job);
+	trucks.swap(result.trucks);
+	foundTick = result.tick;
+	return true;
+}
+
+void RewindBuffer::requestSeek(std::uint64_t tick)
+{
+	// one seek at a time, keep only the latest request while one is running
+	if (mSeek.valid())
+	{
+		mSeekQueued = true;
+		mQueuedTick = tick;
+		return;
+	}
+
+	SeekJob job;
+	if (!buildSeekJob(tick, job))
+		return;
+
+	mSeek = std::async(std::launch::async, [job]() { return runSeekJob(job); });
+}
+
+bool RewindBuffer::pollSeek(std::vector<Truck>& trucks, std::uint64_t& foundTick)
+{
+	if (!mSeek.valid() || mSeek.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return false;
+
+	SeekResult result = mSeek.get();
+	bool cancelled = mSeekCancelled;
+	mSeekCancelled = false;
+
+	if (mSeekQueued)
+	{
+		mSeekQueued = false;
+		requestSeek(mQueuedTick);
+	}
+
+	if (cancelled)
+		return false;
+
+	trucks.swap(result.trucks);
+	foundTick = result.tick;
+	return true;
+}
+
+void RewindBuffer::cancelSeek()
+{
+	mSeekQueued = false;
+	mSeekCancelled = mSeek.valid();
+}
@@ -0,0 +1,127 @@
+#ifndef REWIND_BUFFER_H
+#define REWIND_BUFFER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Fleet.h"
+
+// fixed size history of fleet snapshots (position, wheel angle and tray angle of every truck)
+// values are quantised to fixed point, then every frame stores the difference to a prediction from the frames before it
+// a keyframe predicts zero, the wheel angle and position continue the last step and the tray angle repeats the last value
+// differences are packed by their significant bytes, so trucks moving at a steady speed cost a few bits
+// encoding runs on a thread owned by the buffer, when the budget is used up the oldest keyframe and its deltas are dropped
+// the budget holds both the encoded frames and their index, it is split between them when a history starts
+class RewindBuffer
+{
+public:
+	RewindBuffer(size_t budgetBytes = 16 * 1024 * 1024, unsigned maxKeyframeInterval = 60);
+	~RewindBuffer();
+
+	// change the memory budget and the longest keyframe interval, clears the history
+	void configure(size_t budgetBytes, unsigned maxKeyframeInterval);
+	void clear();
+
+	// add the state after a tick, ticks must increase, a lower tick or a new truck count starts a new history
+	// the trucks are copied and encoded on the encoder thread, the frame joins the history on the next record() or flush()
+	// never waits, a tick arriving while the encoder is still busy is skipped and seeks find the tick before it
+	void record(std::uint64_t tick, const std::vector<Truck>& trucks);
+	// wait for the frame being encoded and add it to the history
+	void flush();
+
+	// rebuild the newest recorded tick <= tick, decodes at most keyframeInterval frames
+	// returns false if the tick is older than the history
+	bool seek(std::uint64_t tick, std::vector<Truck>& trucks, std::uint64_t& foundTick) const;
+
+	// seek on a worker thread so the caller never waits on the decode
+	// only the compressed frames are copied on the calling thread
+	void requestSeek(std::uint64_t tick);
+	// true once a requested seek has finished, fills the result
+	bool pollSeek(std::vector<Truck>& trucks, std::uint64_t& foundTick);
+	// forget requested seeks, a running one finishes but its result is never returned
+	void cancelSeek();
+
+	bool empty() const { return mNumFrames == 0; }
+	std::uint64_t getOldestTick() const { return empty() ? 0 : frame(0).tick; }
+	std::uint64_t getNewestTick() const { return empty() ? 0 : frame(mNumFrames - 1).tick; }
+	// encoded frames plus their index entries
+	size_t getUsedBytes() const { return mUsedBytes; }
+	size_t getBudgetBytes() const { return mBudget; }
+	// frames per keyframe group, limited so a group of the current fleet always fits the budget
+	unsigned getKeyframeInterval() const { return mKeyframeInterval; }
+
+private:
+	// where a frame's bytes live in the ring, kept small since every frame pays for one
+	struct Frame
+	{
+		std::uint64_t tick;
+		std::uint32_t offset;
+		std::uint32_t size : 31;
+		std::uint32_t keyframe : 1;
+	};
+
+	// a keyframe and the deltas up to the sought tick, decoded off thread
+	struct SeekJob
+	{
+		std::uint64_t tick = 0;
+		unsigned numTrucks = 0;
+		std::vector<std::uint32_t> sizes;	// bytes per frame, the first is the keyframe
+		std::vector<std::uint8_t> data;		// frames back to back
+	};
+
+	struct SeekResult
+	{
+		std::uint64_t tick = 0;
+		std::vector<Truck> trucks;
+	};
+
+	size_t mBudget = 0;						// bytes for the data and index rings together
+	size_t mUsedBytes = 0;					// bytes of both taken by the frames in the history
+	std::vector<std::uint8_t> mData;		// ring of encoded frames
+	size_t mWrite = 0;						// offset the next frame is written at
+	std::vector<Frame> mIndex;				// ring of frames, oldest first, the first is always a keyframe
+	size_t mFirstFrame = 0;					// slot of the oldest frame
+	size_t mNumFrames = 0;
+	unsigned mMaxKeyframeInterval;
+	unsigned mKeyframeInterval = 1;			// derived from the budget when a history starts
+	unsigned mSinceKeyframe = 0;			// deltas written since the last keyframe
+	unsigned mNumTrucks = 0;				// trucks per frame in the current history
+
+	// owned by the encoder while mEncodeBusy is set
+	std::vector<Truck> mSnapshot;			// copy of the trucks being recorded
+	std::vector<std::uint32_t> mCurrent;	// quantised words of the tick being recorded
+	std::vector<std::uint32_t> mPrevious;	// quantised words of the last recorded tick
+	std::vector<std::uint32_t> mPrevious2;	// and the one before
+	std::vector<std::uint8_t> mEncoded;		// the frame being recorded
+
+	std::thread mEncoder;					// started by the first record()
+	std::mutex mEncodeMutex;				// guards the two flags below
+	std::condition_variable mEncodeWake;	// signals a new snapshot to the encoder and a finished one back
+	bool mEncodeBusy = false;				// a snapshot was handed over and is not encoded yet
+	bool mStopEncoder = false;
+	bool mEncodePending = false;			// a frame was handed over and not yet added to the history, render thread only
+	std::uint64_t mEncodeTick = 0;			// tick and prediction order it was handed over with
+	unsigned mEncodeOrder = 0;
+
+	std::future<SeekResult> mSeek;			// running asynchronous seek
+	bool mSeekQueued = false;				// a seek was requested while one was running
+	std::uint64_t mQueuedTick = 0;
+	bool mSeekCancelled = false;			// drop the result of the running seek
+
+	const Frame& frame(size_t i) const { return mIndex[(mFirstFrame + i) % mIndex.size()]; }
+	void layout(size_t numWords);
+	size_t allocate(size_t size);
+	void evictGroup();
+	void runEncoder();
+	void encodeSnapshot(unsigned order);
+	bool encoderBusy();
+	void commit();
+	bool buildSeekJob(std::uint64_t tick, SeekJob& job) const;
+	static SeekResult runSeekJob(const SeekJob& job);
+};
+
+#endif
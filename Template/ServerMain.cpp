@@ -0,0 +1,12 @@
+#include <cstdlib>
+#include "SimulationServer.h"
+
+// entry point of the windowless simulation server, built without GLFW, GLEW or AntTweakBar
+int main(int argc, char** argv)
+{
+	ServerSettings settings;
+	if (!parse_server_args(argc, argv, settings))
+		return EXIT_FAILURE;
+
+	return run_server(settings);
+}
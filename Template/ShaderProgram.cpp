@@ -155,6 +155,12 @@ void ShaderProgram::use()
 	glUseProgram(mProgramID);
 }
 
+// get the shader program handle
+GLuint ShaderProgram::getID() const
+{
+	return mProgramID;
+}
+
 void ShaderProgram::setUniform(const char *name, const glm::vec2& vector)
 {
 	glUniform2fv(getUniformLocation(name), 1, &vector[0]);
@@ -19,6 +19,8 @@ public:
 	void compileAndLink(const std::string vShaderFilename, const std::string fShaderFilename);
 	// use the shader program
 	void use();
+	// get the shader program handle
+	GLuint getID() const;
 
 	// functions to set shader uniform variables
 	void setUniform(const char *name, const glm::vec2& vector);
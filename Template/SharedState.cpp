@@ -0,0 +1,244 @@
+#include "SharedState.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const std::uint32_t SHARED_STATE_MAGIC = 0x4B435254;	// "TRCK"
+
+	// keep frames on their own cache lines
+	size_t frame_stride(unsigned capacity)
+	{
+		size_t bytes = sizeof(SharedFrame) + sizeof(SharedTruck) * capacity;
+		return (bytes + 63) & ~static_cast<size_t>(63);
+	}
+
+	const size_t HEADER_SIZE = 64;
+}
+
+SharedState::~SharedState()
+{
+	close();
+}
+
+bool SharedState::create(const std::string& name, unsigned capacity)
+{
+	close();
+
+	mName = name;
+	mOwner = true;
+	mSize = HEADER_SIZE + frame_stride(capacity) * 2;
+	if (!map(true))
+		return false;
+
+	// construct the atomics in place, then publish the magic last so readers only see a complete header
+	SharedHeader* h = new (mMemory) SharedHeader();
+	h->capacity = capacity;
+	h->frameStride = static_cast<std::uint32_t>(frame_stride(capacity));
+	h->latest.store(0, std::memory_order_relaxed);
+
+	for (std::uint32_t i = 0; i < 2; i++)
+	{
+		SharedFrame* f = new (frame(i)) SharedFrame();
+		f->sequence.store(0, std::memory_order_relaxed);
+		f->numTrucks = 0;
+		f->tick = 0;
+	}
+
+	std::atomic_thread_fence(std::memory_order_release);
+	h->magic = SHARED_STATE_MAGIC;
+	return true;
+}
+
+bool SharedState::open(const std::string& name)
+{
+	close();
+
+	mName = name;
+	mOwner = false;
+
+	// map the header first to find out the full size
+	mSize = HEADER_SIZE;
+	if (!map(false))
+		return false;
+
+	if (header()->magic != SHARED_STATE_MAGIC)
+	{
+		std::cerr << "Shared state " << name << " is not initialised" << std::endl;
+		close();
+		return false;
+	}
+
+	size_t size = HEADER_SIZE + static_cast<size_t>(header()->frameStride) * 2;
+	close();
+	mName = name;
+	mSize = size;
+	return map(false);
+}
+
+void SharedState::close()
+{
+	if (mMemory == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mMemory);
+	CloseHandle(static_cast<HANDLE>(mHandle));
+	mHandle = nullptr;
+#else
+	munmap(mMemory, mSize);
+	if (mOwner)
+		shm_unlink(mName.c_str());
+#endif
+
+	mMemory = nullptr;
+	mSize = 0;
+}
+
+bool SharedState::map(bool create)
+{
+#ifdef _WIN32
+	// windows names have no leading slash
+	std::string name = (!mName.empty() && mName[0] == '/') ? mName.substr(1) : mName;
+	HANDLE handle;
+	if (create)
+	{
+		unsigned long long size = mSize;
+		handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), name.c_str());
+	}
+	else
+	{
+		handle = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name.c_str());
+	}
+
+	if (handle == nullptr)
+	{
+		std::cerr << "Failed to open shared memory " << mName << std::endl;
+		return false;
+	}
+
+	mMemory = MapViewOfFile(handle, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, mSize);
+	if (mMemory == nullptr)
+	{
+		CloseHandle(handle);
+		std::cerr << "Failed to map shared memory " << mName << std::endl;
+		return false;
+	}
+	mHandle = handle;
+#else
+	int fd = shm_open(mName.c_str(), create ? (O_CREAT | O_RDWR) : O_RDWR, 0666);
+	if (fd < 0)
+	{
+		std::cerr << "Failed to open shared memory " << mName << std::endl;
+		return false;
+	}
+
+	if (create && ftruncate(fd, static_cast<off_t>(mSize)) != 0)
+	{
+		::close(fd);
+		shm_unlink(mName.c_str());
+		std::cerr << "Failed to size shared memory " << mName << std::endl;
+		return false;
+	}
+
+	void* memory = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);	// the mapping keeps the memory alive
+
+	if (memory == MAP_FAILED)
+	{
+		std::cerr << "Failed to map shared memory " << mName << std::endl;
+		return false;
+	}
+	mMemory = memory;
+#endif
+	return true;
+}
+
+SharedFrame* SharedState::frame(std::uint32_t index) const
+{
+	size_t stride = frame_stride(header()->capacity);
+	return reinterpret_cast<SharedFrame*>(static_cast<char*>(mMemory) + HEADER_SIZE + stride * index);
+}
+
+void SharedState::publish(std::uint64_t tick, const std::vector<Truck>& trucks)
+{
+	SharedHeader* h = header();
+
+	// write the frame readers are not being pointed at
+	std::uint32_t index = h->latest.load(std::memory_order_relaxed) ^ 1;
+	SharedFrame* f = frame(index);
+
+	// odd sequence tells readers the frame is being written
+	std::uint32_t sequence = f->sequence.load(std::memory_order_relaxed);
+	f->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	std::uint32_t count = static_cast<std::uint32_t>(std::min<size_t>(trucks.size(), h->capacity));
+	SharedTruck* out = f->trucks();
+	for (std::uint32_t i = 0; i < count; i++)
+	{
+		out[i].x = trucks[i].x;
+		out[i].speed = trucks[i].speed;
+		out[i].wheelAngle = trucks[i].wheelAngle;
+		out[i].trayAngle = trucks[i].trayAngle;
+	}
+	f->numTrucks = count;
+	f->tick = tick;
+
+	f->sequence.store(sequence + 2, std::memory_order_release);
+	h->latest.store(index, std::memory_order_release);
+}
+
+const SharedFrame* SharedState::beginRead(std::uint32_t& sequence) const
+{
+	for (;;)
+	{
+		const SharedFrame* f = frame(header()->latest.load(std::memory_order_acquire));
+		sequence = f->sequence.load(std::memory_order_acquire);
+		if ((sequence & 1) == 0)
+			return f;
+
+		// the writer lapped us onto the frame it is filling, pick the latest again
+		std::this_thread::yield();
+	}
+}
+
+bool SharedState::endRead(const SharedFrame* frame, std::uint32_t sequence) const
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return frame->sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+bool SharedState::read(std::uint64_t& tick, std::vector<SharedTruck>& trucks) const
+{
+	if (mMemory == nullptr)
+		return false;
+
+	const SharedFrame* f;
+	std::uint32_t sequence;
+	do
+	{
+		f = beginRead(sequence);
+		tick = f->tick;
+		// a torn count is caught by endRead, but must not overrun the frame first
+		trucks.resize(std::min(f->numTrucks, header()->capacity));
+		if (!trucks.empty())
+			std::memcpy(trucks.data(), f->trucks(), sizeof(SharedTruck) * trucks.size());
+	} while (!endRead(f, sequence));
+
+	return sequence != 0;
+}
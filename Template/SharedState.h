@@ -0,0 +1,80 @@
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Fleet.h"
+
+// truck state as laid out in shared memory
+struct SharedTruck
+{
+	float x;
+	float speed;
+	float wheelAngle;
+	float trayAngle;
+};
+
+// one published tick, followed in memory by capacity SharedTruck entries
+struct SharedFrame
+{
+	std::atomic<std::uint32_t> sequence;	// odd while the frame is being written
+	std::uint32_t numTrucks;
+	std::uint64_t tick;
+
+	const SharedTruck* trucks() const { return reinterpret_cast<const SharedTruck*>(this + 1); }
+	SharedTruck* trucks() { return reinterpret_cast<SharedTruck*>(this + 1); }
+};
+
+// start of the shared memory region
+struct SharedHeader
+{
+	std::uint32_t magic;					// SHARED_STATE_MAGIC once the region is set up
+	std::uint32_t capacity;					// trucks per frame
+	std::uint32_t frameStride;				// bytes between the two frames
+	std::atomic<std::uint32_t> latest;		// index of the last completed frame
+};
+
+// simulation state double buffered in a named shared memory region
+// the server publishes every tick, readers in other processes read the latest frame in place
+// each frame is guarded by a sequence lock, so readers never block the writer
+class SharedState
+{
+public:
+	~SharedState();
+
+	// create the region for up to capacity trucks (server)
+	bool create(const std::string& name, unsigned capacity);
+	// map an existing region (reader)
+	bool open(const std::string& name);
+	void close();
+
+	// write a tick into the back frame and make it the latest (server only)
+	void publish(std::uint64_t tick, const std::vector<Truck>& trucks);
+
+	// zero-copy read, use the returned frame then check it with endRead
+	// do { frame = beginRead(sequence); ...; } while (!endRead(frame, sequence));
+	const SharedFrame* beginRead(std::uint32_t& sequence) const;
+	// true if the frame was not written to since beginRead
+	bool endRead(const SharedFrame* frame, std::uint32_t sequence) const;
+
+	// copy out a consistent snapshot, returns false if nothing has been published
+	bool read(std::uint64_t& tick, std::vector<SharedTruck>& trucks) const;
+
+private:
+	std::string mName;
+	void* mMemory = nullptr;		// mapped region
+	size_t mSize = 0;				// size of the mapped region
+	bool mOwner = false;			// created by this process, removed on close
+#ifdef _WIN32
+	void* mHandle = nullptr;		// file mapping handle
+#endif
+
+	bool map(bool create);
+	SharedHeader* header() const { return static_cast<SharedHeader*>(mMemory); }
+	SharedFrame* frame(std::uint32_t index) const;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "Simulation.h"
+
+void Simulation::reset(unsigned numTrucks, unsigned numObstacles, bool withDriver)
+{
+	mFleet.spawn(numTrucks, numObstacles, withDriver);
+	mHasDriver = withDriver;
+	mTick = 0;
+}
+
+void Simulation::tick(float deltaTime, const DriverInput& input)
+{
+	if (mHasDriver)
+	{
+		Truck& driver = mFleet.getTrucks()[0];
+		driver.speed = input.speed;
+		driver.trayAngle = input.trayAngle;
+	}
+
+	mFleet.step(deltaTime);
+	mTick++;
+}
@@ -0,0 +1,35 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <cstdint>
+#include "Fleet.h"
+
+// controls for the driven truck, read from the keyboard and tweak bar when rendering
+struct DriverInput
+{
+	float speed = 0.0f;			// velocity along the road
+	float trayAngle = 0.0f;		// tipper angle in degrees
+};
+
+// simulation state with no window, GL or UI dependencies
+// the render loop and the server mode both step it through tick()
+class Simulation
+{
+public:
+	// replace the fleet, with a driver truck 0 is steered by the input passed to tick()
+	void reset(unsigned numTrucks, unsigned numObstacles, bool withDriver);
+	// advance the simulation by one step
+	void tick(float deltaTime, const DriverInput& input);
+
+	Fleet& getFleet() { return mFleet; }
+	const Fleet& getFleet() const { return mFleet; }
+	std::uint64_t getTick() const { return mTick; }
+	bool hasDriver() const { return mHasDriver; }
+
+private:
+	Fleet mFleet;
+	std::uint64_t mTick = 0;	// steps since the last reset
+	bool mHasDriver = true;
+};
+
+#endif
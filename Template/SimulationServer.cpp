@@ -0,0 +1,80 @@
+#include "SimulationServer.h"
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "CommandLine.h"
+#include "Simulation.h"
+#include "SharedState.h"
+
+bool parse_server_args(int argc, char** argv, ServerSettings& settings)
+{
+	std::vector<CommandOption> options = {
+		{ nullptr, [&settings](const char* value) { return parse_unsigned(value, settings.numTrucks, 1); } },
+		{ "--ticks", [&settings](const char* value) { return parse_uint64(value, settings.maxTicks); } },
+		{ "--obstacles", [&settings](const char* value) { return parse_unsigned(value, settings.numObstacles); } },
+		{ "--name", [&settings](const char* value) { settings.sharedName = value; return !settings.sharedName.empty(); } },
+	};
+
+	return parse_command_line(argc, argv, 1, options, "TruckServer [trucks] [--ticks n] [--obstacles n] [--name /shm]");
+}
+
+// set from SIGINT and SIGTERM, the loop then ends normally and SharedState removes the segment on the way out
+static volatile std::sig_atomic_t gStopRequested = 0;
+
+static void request_stop(int)
+{
+	gStopRequested = 1;
+}
+
+int run_server(const ServerSettings& settings)
+{
+	Simulation simulation;
+	simulation.reset(settings.numTrucks, settings.numObstacles, false);
+
+	SharedState shared;
+	if (!shared.create(settings.sharedName, settings.numTrucks))
+		return EXIT_FAILURE;
+
+	std::cout << "Simulating " << settings.numTrucks << " trucks, publishing to " << settings.sharedName << std::endl;
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	Clock::time_point lastReport = start;
+	std::uint64_t lastReportTick = 0;
+	DriverInput noDriver;
+
+	std::signal(SIGINT, request_stop);
+	std::signal(SIGTERM, request_stop);
+
+	while (!gStopRequested && (settings.maxTicks == 0 || simulation.getTick() < settings.maxTicks))
+	{
+		simulation.tick(settings.tickTime, noDriver);
+		shared.publish(simulation.getTick(), simulation.getFleet().getTrucks());
+
+		// checking the clock every tick is measurable for small fleets
+		if ((simulation.getTick() & 255) != 0)
+			continue;
+
+		Clock::time_point now = Clock::now();
+		double elapsed = std::chrono::duration<double>(now - lastReport).count();
+		if (elapsed > 1.0)
+		{
+			const FleetStats& stats = simulation.getFleet().getStats();
+			std::cout << "ticks/s: " << static_cast<std::uint64_t>((simulation.getTick() - lastReportTick) / elapsed)
+				<< "  tick: " << simulation.getTick()
+				<< "  pairs: " << stats.candidatePairs
+				<< "  contacts: " << stats.contacts << std::endl;
+
+			lastReport = now;
+			lastReportTick = simulation.getTick();
+		}
+	}
+
+	double total = std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << "Ran " << simulation.getTick() << " ticks in " << total << " s ("
+		<< static_cast<std::uint64_t>(simulation.getTick() / total) << " ticks/s)" << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,24 @@
+#ifndef SIMULATION_SERVER_H
+#define SIMULATION_SERVER_H
+
+#include <cstdint>
+#include <string>
+
+// windowless server mode settings, parsed from the command line
+struct ServerSettings
+{
+	unsigned numTrucks = 1000;			// trucks to simulate
+	unsigned numObstacles = 2;			// obstacles on the road
+	std::uint64_t maxTicks = 0;			// stop after this many ticks, 0 runs until killed
+	float tickTime = 1.0f / 60.0f;		// simulated seconds per tick
+	std::string sharedName = "/truck_sim";	// shared memory name readers open
+};
+
+// step the simulation as fast as possible with no window, GL or UI, publishing every tick to shared memory
+// reports ticks per second on stdout, returns the process exit code
+int run_server(const ServerSettings& settings);
+
+// fill settings from "[trucks] [--ticks n] [--obstacles n] [--name /shm]", prints usage and returns false if argv is invalid
+bool parse_server_args(int argc, char** argv, ServerSettings& settings);
+
+#endif
@@ -0,0 +1,276 @@
+#include "SoftwareRenderer.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "CpuSupport.h"
+#include "WorkerPool.h"
+
+namespace
+{
+	// vertex positions per pixel, 8 bits of sub-pixel precision like most GL rasterisers
+	const float SUBPIXEL_STEPS = 256.0f;
+
+	// float colour to an RGBA8 pixel, rounded the same way GL converts to unorm
+	std::uint32_t pack_colour(float r, float g, float b)
+	{
+		std::uint32_t ri = static_cast<std::uint32_t>(std::min(std::max(r, 0.0f), 1.0f) * 255.0f + 0.5f);
+		std::uint32_t gi = static_cast<std::uint32_t>(std::min(std::max(g, 0.0f), 1.0f) * 255.0f + 0.5f);
+		std::uint32_t bi = static_cast<std::uint32_t>(std::min(std::max(b, 0.0f), 1.0f) * 255.0f + 0.5f);
+		return ri | (gi << 8) | (bi << 16) | 0xFF000000u;
+	}
+}
+
+void SoftwareRenderer::setMesh(GLuint vao, const std::vector<GLfloat>& vertices)
+{
+	std::vector<MeshVertex>& mesh = mMeshes[vao];
+	mesh.resize(vertices.size() * sizeof(GLfloat) / sizeof(MeshVertex));
+	if (!mesh.empty())
+		std::memcpy(mesh.data(), vertices.data(), mesh.size() * sizeof(MeshVertex));
+}
+
+void SoftwareRenderer::addTriangle(ScreenVertex v0, ScreenVertex v1, ScreenVertex v2)
+{
+	// counter clockwise so the edge functions are positive inside, strips alternate winding
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if (area == 0.0f)
+		return;
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	Triangle tri;
+	tri.minX = std::max(0, static_cast<int>(std::floor(std::min(v0.x, std::min(v1.x, v2.x)))));
+	tri.minY = std::max(0, static_cast<int>(std::floor(std::min(v0.y, std::min(v1.y, v2.y)))));
+	tri.maxX = std::min(mWidth - 1, static_cast<int>(std::ceil(std::max(v0.x, std::max(v1.x, v2.x)))));
+	tri.maxY = std::min(mHeight - 1, static_cast<int>(std::ceil(std::max(v0.y, std::max(v1.y, v2.y)))));
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+		return;
+
+	// edge i is opposite vertex i, so it is also vertex i's barycentric weight times the area
+	// each edge is evaluated relative to its lower endpoint, so the triangle on the other side computes the exact
+	// negation and pixels on shared edges are neither dropped nor drawn twice
+	const ScreenVertex* v[3] = { &v0, &v1, &v2 };
+	float edgeC[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const ScreenVertex& a = *v[(i + 1) % 3];
+		const ScreenVertex& b = *v[(i + 2) % 3];
+		tri.edgeA[i] = a.y - b.y;
+		tri.edgeB[i] = b.x - a.x;
+
+		const ScreenVertex& origin = (a.x < b.x || (a.x == b.x && a.y < b.y)) ? a : b;
+		tri.originX[i] = origin.x;
+		tri.originY[i] = origin.y;
+		edgeC[i] = -(tri.edgeA[i] * origin.x + tri.edgeB[i] * origin.y);
+
+		// top-left fill rule as seen on screen, pixels exactly on a shared edge belong to one triangle only
+		// rows are stored bottom first, so the top edge on screen is the one with the inside above it, the same as GL
+		bool topLeft = tri.edgeA[i] > 0.0f || (tri.edgeA[i] == 0.0f && tri.edgeB[i] > 0.0f);
+		tri.threshold[i] = topLeft ? 0.0f : FLT_MIN;
+	}
+
+	// colour planes from the barycentric weights
+	float inverseArea = 1.0f / area;
+	for (int c = 0; c < 3; c++)
+	{
+		float c0 = c == 0 ? v0.r : (c == 1 ? v0.g : v0.b);
+		float c1 = c == 0 ? v1.r : (c == 1 ? v1.g : v1.b);
+		float c2 = c == 0 ? v2.r : (c == 1 ? v2.g : v2.b);
+		tri.colourA[c] = (tri.edgeA[0] * c0 + tri.edgeA[1] * c1 + tri.edgeA[2] * c2) * inverseArea;
+		tri.colourB[c] = (tri.edgeB[0] * c0 + tri.edgeB[1] * c1 + tri.edgeB[2] * c2) * inverseArea;
+		tri.colourC[c] = (edgeC[0] * c0 + edgeC[1] * c1 + edgeC[2] * c2) * inverseArea;
+	}
+
+	// bin into every tile the bounds touch, in draw order
+	std::uint32_t index = static_cast<std::uint32_t>(mTriangles.size());
+	mTriangles.push_back(tri);
+	for (int ty = tri.minY / TILE_SIZE; ty <= tri.maxY / TILE_SIZE; ty++)
+	{
+		for (int tx = tri.minX / TILE_SIZE; tx <= tri.maxX / TILE_SIZE; tx++)
+			mBins[ty * mTilesX + tx].push_back(index);
+	}
+}
+
+void SoftwareRenderer::render(RenderQueue& queue, const glm::vec3& clearColour, int width, int height)
+{
+	auto binStart = std::chrono::steady_clock::now();
+
+	// resize the framebuffer and tile grid
+	if (width != mWidth || height != mHeight)
+	{
+		mWidth = std::max(width, 1);
+		mHeight = std::max(height, 1);
+		mPitch = (mWidth + 3) & ~3;
+		mPixels.assign(static_cast<size_t>(mPitch) * mHeight, 0);
+		mTilesX = (mWidth + TILE_SIZE - 1) / TILE_SIZE;
+		mTilesY = (mHeight + TILE_SIZE - 1) / TILE_SIZE;
+		mBins.assign(mTilesX * mTilesY, std::vector<std::uint32_t>());
+	}
+
+	mClearPixel = pack_colour(clearColour.r, clearColour.g, clearColour.b);
+	mTriangles.clear();
+	for (std::vector<std::uint32_t>& bin : mBins)
+		bin.clear();
+
+	// transform and assemble triangles in queue order, so tiles keep the same layering as GL
+	for (const DrawItem& item : queue.getItems())
+	{
+		const DrawPayload& payload = queue.getPayload(item);
+
+		auto mesh = mMeshes.find(payload.vao);
+		if (mesh == mMeshes.end())
+			continue;
+		if (payload.mode != GL_TRIANGLES && payload.mode != GL_TRIANGLE_STRIP && payload.mode != GL_TRIANGLE_FAN)
+			continue;
+		if (payload.first < 0 || static_cast<size_t>(payload.first + payload.count) > mesh->second.size())
+			continue;
+
+		// model matrix then clip space to pixels, the scene is flat so w stays 1
+		// positions snap to the 1/256 pixel grid GL rasterises on, so edges through pixel centres land the same way
+		const glm::mat4& m = payload.modelMatrix;
+		std::vector<ScreenVertex>& screen = mScreen;
+		screen.resize(payload.count);
+		for (GLsizei i = 0; i < payload.count; i++)
+		{
+			const MeshVertex& in = mesh->second[payload.first + i];
+			float x = m[0][0] * in.position[0] + m[1][0] * in.position[1] + m[2][0] * in.position[2] + m[3][0];
+			float y = m[0][1] * in.position[0] + m[1][1] * in.position[1] + m[2][1] * in.position[2] + m[3][1];
+
+			screen[i].x = std::round((x * 0.5f + 0.5f) * mWidth * SUBPIXEL_STEPS) / SUBPIXEL_STEPS;
+			screen[i].y = std::round((y * 0.5f + 0.5f) * mHeight * SUBPIXEL_STEPS) / SUBPIXEL_STEPS;
+			screen[i].r = in.colour[0];
+			screen[i].g = in.colour[1];
+			screen[i].b = in.colour[2];
+		}
+
+		if (payload.mode == GL_TRIANGLES)
+		{
+			for (GLsizei i = 0; i + 2 < payload.count; i += 3)
+				addTriangle(screen[i], screen[i + 1], screen[i + 2]);
+		}
+		else if (payload.mode == GL_TRIANGLE_STRIP)
+		{
+			for (GLsizei i = 0; i + 2 < payload.count; i++)
+				addTriangle(screen[i], screen[i + 1], screen[i + 2]);
+		}
+		else
+		{
+			for (GLsizei i = 1; i + 1 < payload.count; i++)
+				addTriangle(screen[0], screen[i], screen[i + 1]);
+		}
+	}
+
+	mBinTimeMs = elapsed_ms(binStart);
+	auto rasterStart = std::chrono::steady_clock::now();
+
+	// pool threads take tiles until none are left, tiles never share pixels
+	WorkerPool::shared().run(static_cast<unsigned>(mTilesX * mTilesY), [this](unsigned tile) {
+		rasteriseTile(static_cast<int>(tile));
+	});
+
+	mRasterTimeMs = elapsed_ms(rasterStart);
+}
+
+void SoftwareRenderer::rasteriseTile(int tile)
+{
+	int tileX0 = (tile % mTilesX) * TILE_SIZE;
+	int tileY0 = (tile / mTilesX) * TILE_SIZE;
+	int tileX1 = std::min(tileX0 + TILE_SIZE, mWidth) - 1;
+	int tileY1 = std::min(tileY0 + TILE_SIZE, mHeight) - 1;
+
+	// clear, including the row padding inside this tile
+	int clearEnd = std::min(tileX0 + TILE_SIZE, mPitch);
+	for (int y = tileY0; y <= tileY1; y++)
+		std::fill(&mPixels[y * mPitch + tileX0], &mPixels[y * mPitch + clearEnd], mClearPixel);
+
+	for (std::uint32_t index : mBins[tile])
+	{
+		const Triangle& tri = mTriangles[index];
+
+		// tiles start on a multiple of 4, so four pixel groups never cross into the next tile
+		int minX = std::max(tri.minX, tileX0) & ~3;
+		int maxX = std::min(tri.maxX, tileX1);
+		int minY = std::max(tri.minY, tileY0);
+		int maxY = std::min(tri.maxY, tileY1);
+
+#if USE_SSE2
+		const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		__m128 edgeA[3], originX[3], threshold[3], colourA[3];
+		for (int i = 0; i < 3; i++)
+		{
+			edgeA[i] = _mm_set1_ps(tri.edgeA[i]);
+			originX[i] = _mm_set1_ps(tri.originX[i]);
+			threshold[i] = _mm_set1_ps(tri.threshold[i]);
+			colourA[i] = _mm_set1_ps(tri.colourA[i]);
+		}
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 scale = _mm_set1_ps(255.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			float py = y + 0.5f;
+			std::uint32_t* row = &mPixels[y * mPitch];
+
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+
+				// inside all three half-spaces
+				__m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (int i = 0; i < 3; i++)
+				{
+					__m128 e = _mm_add_ps(_mm_mul_ps(edgeA[i], _mm_sub_ps(px, originX[i])), _mm_set1_ps(tri.edgeB[i] * (py - tri.originY[i])));
+					mask = _mm_and_ps(mask, _mm_cmpge_ps(e, threshold[i]));
+				}
+				if (_mm_movemask_ps(mask) == 0)
+					continue;
+
+				// interpolate and pack the colour
+				__m128i packed = alpha;
+				for (int c = 0; c < 3; c++)
+				{
+					__m128 value = _mm_add_ps(_mm_mul_ps(colourA[c], px), _mm_set1_ps(tri.colourB[c] * py + tri.colourC[c]));
+					value = _mm_min_ps(_mm_max_ps(value, zero), one);
+					__m128i channel = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+					packed = _mm_or_si128(packed, _mm_slli_epi32(channel, c * 8));
+				}
+
+				// write only the covered pixels
+				__m128i* target = reinterpret_cast<__m128i*>(row + x);
+				__m128i old = _mm_loadu_si128(target);
+				__m128i coverage = _mm_castps_si128(mask);
+				_mm_storeu_si128(target, _mm_or_si128(_mm_and_si128(coverage, packed), _mm_andnot_si128(coverage, old)));
+			}
+		}
+#else
+		for (int y = minY; y <= maxY; y++)
+		{
+			float py = y + 0.5f;
+			std::uint32_t* row = &mPixels[y * mPitch];
+
+			for (int x = minX; x <= maxX; x++)
+			{
+				float px = x + 0.5f;
+
+				bool inside = true;
+				for (int i = 0; i < 3; i++)
+					inside = inside && tri.edgeA[i] * (px - tri.originX[i]) + tri.edgeB[i] * (py - tri.originY[i]) >= tri.threshold[i];
+				if (!inside)
+					continue;
+
+				row[x] = pack_colour(
+					tri.colourA[0] * px + (tri.colourB[0] * py + tri.colourC[0]),
+					tri.colourA[1] * px + (tri.colourB[1] * py + tri.colourC[1]),
+					tri.colourA[2] * px + (tri.colourB[2] * py + tri.colourC[2]));
+			}
+		}
+#endif
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "Renderer.h"
+
+// pure CPU backend for hosts without a GPU or GL stack
+// triangles are binned into screen tiles, then tiles are rasterised on the shared worker pool with half-space edge functions,
+// four pixels at a time with SSE2, into an in-memory RGBA8 framebuffer
+// only triangle primitives from registered meshes are drawn, points (the tipper load) are skipped
+class SoftwareRenderer : public Renderer
+{
+public:
+	// give the rasteriser a CPU copy of the vertex data behind a VAO, same interleaved layout as VertexColor
+	void setMesh(GLuint vao, const std::vector<GLfloat>& vertices);
+
+	void render(RenderQueue& queue, const glm::vec3& clearColour, int width, int height) override;
+	const char* getName() const override { return "Software"; }
+
+	// RGBA8 pixels, bottom row first like glReadPixels, rows are getPitch() pixels apart
+	const std::vector<std::uint32_t>& getPixels() const { return mPixels; }
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+	int getPitch() const { return mPitch; }
+
+	// time spent in the last render
+	float getBinTimeMs() const { return mBinTimeMs; }
+	float getRasterTimeMs() const { return mRasterTimeMs; }
+
+	static const int TILE_SIZE = 64;
+
+private:
+	// matches VertexColor
+	struct MeshVertex
+	{
+		float position[3];
+		float colour[3];
+	};
+
+	// vertex after the model matrix and viewport transform
+	struct ScreenVertex
+	{
+		float x, y;
+		float r, g, b;
+	};
+
+	// set up triangle, every value is a plane a * x + b * y + c over the screen
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3];				// edge functions a * (x - originX) + b * (y - originY), positive inside
+		float originX[3], originY[3];			// the same endpoint for both triangles sharing an edge
+		float threshold[3];						// 0 for top-left edges, otherwise the smallest positive float
+		float colourA[3], colourB[3], colourC[3];	// r, g, b
+		int minX, minY, maxX, maxY;				// pixel bounds, inclusive
+	};
+
+	std::map<GLuint, std::vector<MeshVertex>> mMeshes;
+	std::vector<ScreenVertex> mScreen;		// vertices of the draw being assembled, reused between draws
+	std::vector<Triangle> mTriangles;
+	std::vector<std::vector<std::uint32_t>> mBins;	// triangle indices per tile, in draw order
+	int mTilesX = 0;
+	int mTilesY = 0;
+
+	std::vector<std::uint32_t> mPixels;
+	int mWidth = 0;
+	int mHeight = 0;
+	int mPitch = 0;					// width rounded up to a multiple of 4
+	std::uint32_t mClearPixel = 0;
+
+	float mBinTimeMs = 0.0f;
+	float mRasterTimeMs = 0.0f;
+
+	void addTriangle(ScreenVertex v0, ScreenVertex v1, ScreenVertex v2);
+	void rasteriseTile(int tile);
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// fixed size lock-free queue for exactly one producer thread and one consumer thread
+// holds Capacity - 1 items, one slot is kept free to tell full from empty
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+	// producer: add an item, returns false if the queue is full
+	bool push(T&& item)
+	{
+		size_t tail = mTail.load(std::memory_order_relaxed);
+		size_t next = (tail + 1) % Capacity;
+		if (next == mHead.load(std::memory_order_acquire))
+			return false;
+
+		mItems[tail] = std::move(item);
+		mTail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// consumer: oldest item or nullptr if empty, stays queued until pop()
+	T* front()
+	{
+		size_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mTail.load(std::memory_order_acquire))
+			return nullptr;
+
+		return &mItems[head];
+	}
+
+	// consumer: remove the item returned by front()
+	void pop()
+	{
+		size_t head = mHead.load(std::memory_order_relaxed);
+		mItems[head] = T();
+		mHead.store((head + 1) % Capacity, std::memory_order_release);
+	}
+
+private:
+	T mItems[Capacity];
+	std::atomic<size_t> mHead{ 0 };	// next item to consume, written by the consumer
+	std::atomic<size_t> mTail{ 0 };	// next free slot, written by the producer
+};
+
+#endif
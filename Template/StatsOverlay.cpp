@@ -0,0 +1,330 @@
+#include "StatsOverlay.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+
+namespace
+{
+	// 5x7 font for ' ' to 'Z', one byte per row, bit 4 is the leftmost pixel
+	const unsigned char FONT[][7] = {
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+		{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, // '!'
+		{ 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00 }, // '"'
+		{ 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A }, // '#'
+		{ 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 }, // '$'
+		{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // '%'
+		{ 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D }, // '&'
+		{ 0x0C, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 }, // '''
+		{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // '('
+		{ 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // ')'
+		{ 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 }, // '*'
+		{ 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 }, // '+'
+		{ 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, // ','
+		{ 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // '-'
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, // '.'
+		{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // '/'
+		{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, // '0'
+		{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // '1'
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, // '2'
+		{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // '3'
+		{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, // '4'
+		{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // '5'
+		{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, // '6'
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // '7'
+		{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, // '8'
+		{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // '9'
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 }, // ';'
+		{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // '<'
+		{ 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, // '='
+		{ 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // '>'
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '?'
+		{ 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E }, // '@'
+		{ 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 }, // 'A'
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // 'B'
+		{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // 'C'
+		{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // 'D'
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // 'E'
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // 'F'
+		{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // 'G'
+		{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // 'H'
+		{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 'I'
+		{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, // 'J'
+		{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // 'K'
+		{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, // 'L'
+		{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // 'M'
+		{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // 'N'
+		{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // 'O'
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, // 'P'
+		{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // 'Q'
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, // 'R'
+		{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // 'S'
+		{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // 'T'
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // 'U'
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // 'V'
+		{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // 'W'
+		{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, // 'X'
+		{ 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, // 'Y'
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, // 'Z'
+	};
+
+	const int FIRST_GLYPH = ' ';
+	const int NUM_GLYPHS = sizeof(FONT) / sizeof(FONT[0]);
+
+	// atlas layout, one cell per glyph plus a solid cell for untextured quads
+	const int CELL_WIDTH = 6;
+	const int CELL_HEIGHT = 8;
+	const int SOLID_CELL = NUM_GLYPHS;
+	const int ATLAS_WIDTH = CELL_WIDTH * (NUM_GLYPHS + 1);
+	const int ATLAS_HEIGHT = CELL_HEIGHT;
+
+	// size of a font pixel on screen
+	const float TEXT_SCALE = 2.0f;
+	const float LINE_HEIGHT = CELL_HEIGHT * TEXT_SCALE + 2.0f;
+
+	// panel layout in pixels
+	const float PANEL_WIDTH = 256.0f;
+	const float PADDING = 8.0f;
+	const float GRAPH_HEIGHT = 60.0f;
+	const float GRAPH_MAX_MS = 50.0f;		// frame time at the top of the graph
+	const int NUM_BUCKETS = 16;				// histogram buckets
+	const float BUCKET_MS = 2.5f;			// width of a bucket, the last one catches everything slower
+	const float HISTOGRAM_HEIGHT = 40.0f;
+}
+
+StatsOverlay::StatsOverlay()
+{
+	std::fill(mHistory, mHistory + HISTORY, 0.0f);
+}
+
+StatsOverlay::~StatsOverlay()
+{
+	if (mVBO != 0)
+		glDeleteBuffers(1, &mVBO);
+	if (mVAO != 0)
+		glDeleteVertexArrays(1, &mVAO);
+	if (mAtlas != 0)
+		glDeleteTextures(1, &mAtlas);
+}
+
+void StatsOverlay::init()
+{
+	mShader.compileAndLink("overlay.vert", "overlay.frag");
+
+	// bake the font into a single row atlas
+	std::vector<unsigned char> pixels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+	for (int glyph = 0; glyph < NUM_GLYPHS; glyph++)
+	{
+		for (int row = 0; row < 7; row++)
+		{
+			for (int column = 0; column < 5; column++)
+			{
+				if (FONT[glyph][row] & (0x10 >> column))
+					pixels[row * ATLAS_WIDTH + glyph * CELL_WIDTH + column] = 255;
+			}
+		}
+	}
+	for (int row = 0; row < CELL_HEIGHT; row++)
+	{
+		for (int column = 0; column < CELL_WIDTH; column++)
+			pixels[row * ATLAS_WIDTH + SOLID_CELL * CELL_WIDTH + column] = 255;
+	}
+
+	glGenTextures(1, &mAtlas);
+	glBindTexture(GL_TEXTURE_2D, mAtlas);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// create VAO, specify VBO data and format of the data
+	glGenBuffers(1, &mVBO);
+	glGenVertexArrays(1, &mVAO);
+	glBindVertexArray(mVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex),
+		reinterpret_cast<void*>(offsetof(OverlayVertex, position)));
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex),
+		reinterpret_cast<void*>(offsetof(OverlayVertex, texCoord)));
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex),
+		reinterpret_cast<void*>(offsetof(OverlayVertex, colour)));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+}
+
+void StatsOverlay::addFrameTime(float frameTime)
+{
+	mHistory[mHistoryNext] = frameTime * 1000.0f;
+	mHistoryNext = (mHistoryNext + 1) % HISTORY;
+	mHistoryCount = std::min(mHistoryCount + 1, HISTORY);
+}
+
+void StatsOverlay::addLine(const std::string& line)
+{
+	mLines.push_back(line);
+}
+
+float StatsOverlay::getAverageMs() const
+{
+	if (mHistoryCount == 0)
+		return 0.0f;
+
+	float total = 0.0f;
+	for (int i = 0; i < mHistoryCount; i++)
+		total += mHistory[i];
+	return total / mHistoryCount;
+}
+
+float StatsOverlay::getMinMs() const
+{
+	return mHistoryCount == 0 ? 0.0f : *std::min_element(mHistory, mHistory + mHistoryCount);
+}
+
+float StatsOverlay::getMaxMs() const
+{
+	return mHistoryCount == 0 ? 0.0f : *std::max_element(mHistory, mHistory + mHistoryCount);
+}
+
+void StatsOverlay::addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, const glm::vec4& colour)
+{
+	OverlayVertex corners[4] = {
+		{ { x0, y0 }, { u0, v0 }, { colour.x, colour.y, colour.z, colour.w } },
+		{ { x1, y0 }, { u1, v0 }, { colour.x, colour.y, colour.z, colour.w } },
+		{ { x0, y1 }, { u0, v1 }, { colour.x, colour.y, colour.z, colour.w } },
+		{ { x1, y1 }, { u1, v1 }, { colour.x, colour.y, colour.z, colour.w } },
+	};
+
+	// two triangles so every quad goes into the same GL_TRIANGLES batch
+	mVertices.push_back(corners[0]);
+	mVertices.push_back(corners[1]);
+	mVertices.push_back(corners[2]);
+	mVertices.push_back(corners[2]);
+	mVertices.push_back(corners[1]);
+	mVertices.push_back(corners[3]);
+}
+
+void StatsOverlay::addSolid(float x0, float y0, float x1, float y1, const glm::vec4& colour)
+{
+	// sample the middle of the solid cell
+	float u = (SOLID_CELL * CELL_WIDTH + CELL_WIDTH * 0.5f) / ATLAS_WIDTH;
+	float v = 0.5f;
+	addQuad(x0, y0, x1, y1, u, v, u, v, colour);
+}
+
+void StatsOverlay::addText(float x, float y, const std::string& text, const glm::vec4& colour)
+{
+	for (char c : text)
+	{
+		int glyph = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+		glyph -= FIRST_GLYPH;
+		if (glyph < 0 || glyph >= NUM_GLYPHS)
+			glyph = '?' - FIRST_GLYPH;
+
+		// skip spaces but still advance
+		if (glyph != 0)
+		{
+			float u0 = static_cast<float>(glyph * CELL_WIDTH) / ATLAS_WIDTH;
+			float u1 = static_cast<float>(glyph * CELL_WIDTH + 5) / ATLAS_WIDTH;
+			float v1 = 7.0f / ATLAS_HEIGHT;
+			addQuad(x, y, x + 5 * TEXT_SCALE, y + 7 * TEXT_SCALE, u0, 0.0f, u1, v1, colour);
+		}
+
+		x += CELL_WIDTH * TEXT_SCALE;
+	}
+}
+
+void StatsOverlay::draw(int width, int height)
+{
+	mVertices.clear();
+
+	float left = width - PANEL_WIDTH - PADDING;
+	float top = PADDING;
+	float panelHeight = PADDING * 3 + mLines.size() * LINE_HEIGHT + GRAPH_HEIGHT + PADDING + HISTOGRAM_HEIGHT;
+	float x = left + PADDING;
+	float y = top + PADDING;
+	float graphWidth = PANEL_WIDTH - PADDING * 2;
+
+	// background panel
+	addSolid(left, top, left + PANEL_WIDTH, top + panelHeight, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+
+	// text
+	for (const std::string& line : mLines)
+	{
+		addText(x, y, line, glm::vec4(1.0f));
+		y += LINE_HEIGHT;
+	}
+	mLines.clear();
+	y += PADDING;
+
+	// frame time graph, oldest frame on the left, one bar per frame
+	float barWidth = graphWidth / HISTORY;
+	float graphBottom = y + GRAPH_HEIGHT;
+	addSolid(x, y, x + graphWidth, graphBottom, glm::vec4(0.2f, 0.2f, 0.2f, 0.6f));
+
+	for (int i = 0; i < mHistoryCount; i++)
+	{
+		int slot = (mHistoryNext - mHistoryCount + i + HISTORY) % HISTORY;
+		float ms = mHistory[slot];
+		float barHeight = std::min(ms / GRAPH_MAX_MS, 1.0f) * GRAPH_HEIGHT;
+
+		// green on target, yellow up to twice the target, red beyond
+		glm::vec4 colour(0.2f, 0.9f, 0.2f, 0.9f);
+		if (ms > mTargetFrameTimeMs * 2.0f)
+			colour = glm::vec4(0.9f, 0.2f, 0.2f, 0.9f);
+		else if (ms > mTargetFrameTimeMs)
+			colour = glm::vec4(0.9f, 0.9f, 0.2f, 0.9f);
+
+		float barLeft = x + (HISTORY - mHistoryCount + i) * barWidth;
+		addSolid(barLeft, graphBottom - barHeight, barLeft + barWidth, graphBottom, colour);
+	}
+
+	// target line
+	float targetY = graphBottom - std::min(mTargetFrameTimeMs / GRAPH_MAX_MS, 1.0f) * GRAPH_HEIGHT;
+	addSolid(x, targetY, x + graphWidth, targetY + 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.8f));
+	y = graphBottom + PADDING;
+
+	// histogram of the same frames
+	int buckets[NUM_BUCKETS] = { 0 };
+	int largest = 1;
+	for (int i = 0; i < mHistoryCount; i++)
+	{
+		int bucket = std::min(static_cast<int>(mHistory[i] / BUCKET_MS), NUM_BUCKETS - 1);
+		buckets[bucket]++;
+		largest = std::max(largest, buckets[bucket]);
+	}
+
+	float bucketWidth = graphWidth / NUM_BUCKETS;
+	float histogramBottom = y + HISTOGRAM_HEIGHT;
+	for (int b = 0; b < NUM_BUCKETS; b++)
+	{
+		float barHeight = static_cast<float>(buckets[b]) / largest * HISTOGRAM_HEIGHT;
+		float barLeft = x + b * bucketWidth;
+		addSolid(barLeft + 1.0f, histogramBottom - barHeight, barLeft + bucketWidth - 1.0f, histogramBottom, glm::vec4(0.4f, 0.7f, 1.0f, 0.9f));
+	}
+
+	// orphan and refill the streaming buffer, then draw everything at once
+	glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(OverlayVertex) * mVertices.size(), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(OverlayVertex) * mVertices.size(), mVertices.data());
+
+	mShader.use();
+	mShader.setUniform("uScreenSize", glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+	mShader.setUniform("uAtlas", 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, mAtlas);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glBindVertexArray(mVAO);
+	glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(mVertices.size()));
+
+	glDisable(GL_BLEND);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,63 @@
+#ifndef STATS_OVERLAY_H
+#define STATS_OVERLAY_H
+
+#include <string>
+#include <vector>
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+#include "ShaderProgram.h"
+
+// on screen frame stats that do not need AntTweakBar
+// text, frame time graph and histogram are batched into one draw from one streaming buffer
+class StatsOverlay
+{
+public:
+	StatsOverlay();
+	~StatsOverlay();
+
+	// bake the glyph atlas and create the buffers and shader (render thread only)
+	void init();
+	// record a frame time in seconds into the rolling history
+	void addFrameTime(float frameTime);
+	// queue a line of text for the next draw, lower case is drawn as upper case
+	void addLine(const std::string& line);
+	// draw the panel in the top right corner of a window of the given size, clears the queued lines
+	void draw(int width, int height);
+
+	// frame time stats over the history, in ms
+	float getAverageMs() const;
+	float getMinMs() const;
+	float getMaxMs() const;
+
+	bool mVisible = true;				// toggled with F1
+	float mTargetFrameTimeMs = 16.7f;	// drawn as a line on the graph
+
+	static const int HISTORY = 240;		// frames kept for the graph
+
+private:
+	// vertex layout of the streaming buffer
+	struct OverlayVertex
+	{
+		GLfloat position[2];	// pixels from the top left
+		GLfloat texCoord[2];	// atlas coordinates
+		GLfloat colour[4];
+	};
+
+	ShaderProgram mShader;
+	GLuint mAtlas = 0;		// glyph atlas texture
+	GLuint mVBO = 0;
+	GLuint mVAO = 0;
+
+	float mHistory[HISTORY];	// frame times in ms, ring buffer
+	int mHistoryNext = 0;		// next slot to write
+	int mHistoryCount = 0;		// filled slots
+
+	std::vector<std::string> mLines;		// text queued for the next draw
+	std::vector<OverlayVertex> mVertices;	// batch built by draw()
+
+	void addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, const glm::vec4& colour);
+	void addSolid(float x0, float y0, float x1, float y1, const glm::vec4& colour);
+	void addText(float x, float y, const std::string& text, const glm::vec4& colour);
+};
+
+#endif
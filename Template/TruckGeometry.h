@@ -0,0 +1,36 @@
+#ifndef TRUCK_GEOMETRY_H
+#define TRUCK_GEOMETRY_H
+
+#include <glm/glm.hpp>
+
+// truck layout in model space, shared by the mesh, the collision shapes and the particle collider
+// outlines are convex and counter clockwise
+
+// front cabin, from the bottom left
+const int CABIN_POINTS = 5;
+const glm::vec2 CABIN_OUTLINE[CABIN_POINTS] = {
+	glm::vec2(-0.4f, -0.5f), glm::vec2(-0.13f, -0.5f), glm::vec2(-0.13f, -0.05f), glm::vec2(-0.32f, -0.05f), glm::vec2(-0.4f, -0.2f) };
+
+// chassis under the cabin and tray, from the bottom left
+const int BASE_POINTS = 4;
+const glm::vec2 BASE_OUTLINE[BASE_POINTS] = {
+	glm::vec2(-0.4f, -0.55f), glm::vec2(0.4f, -0.55f), glm::vec2(0.4f, -0.5f), glm::vec2(-0.4f, -0.5f) };
+
+// tipper tray, from the top left
+const int TRAY_POINTS = 6;
+const glm::vec2 TRAY_OUTLINE[TRAY_POINTS] = {
+	glm::vec2(-0.05f, -0.08f), glm::vec2(-0.13f, -0.275f), glm::vec2(-0.05f, -0.5f), glm::vec2(0.4f, -0.5f), glm::vec2(0.48f, -0.275f), glm::vec2(0.4f, -0.08f) };
+
+// the tray tips about its bottom right corner
+const glm::vec2 TRAY_PIVOT(0.4f, -0.5f);
+
+// wheels turn about their centres
+const glm::vec2 FRONT_WHEEL_CENTRE(-0.275f, -0.525f);
+const glm::vec2 BACK_WHEEL_CENTRE(0.275f, -0.525f);
+const float TYRE_RADIUS = 0.12f;
+const float RIM_RADIUS = 0.07f;
+
+// road surface, obstacles and the load rest on it
+const float GROUND_Y = -0.625f;
+
+#endif
@@ -0,0 +1,82 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool& WorkerPool::shared()
+{
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+WorkerPool::WorkerPool(unsigned numWorkers)
+	: mNextJob(0)
+{
+	for (unsigned i = 0; i < numWorkers; i++)
+		mWorkers.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWake.notify_all();
+
+	for (std::thread& worker : mWorkers)
+		worker.join();
+}
+
+void WorkerPool::run(unsigned numJobs, const Job& job)
+{
+	// nothing to share, skip the wake up
+	if (mWorkers.empty() || numJobs <= 1)
+	{
+		for (unsigned i = 0; i < numJobs; i++)
+			job(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJob = &job;
+		mNumJobs = numJobs;
+		mNextJob = 0;
+		mBusy = static_cast<unsigned>(mWorkers.size());
+		mGeneration++;
+	}
+	mWake.notify_all();
+
+	takeJobs();
+
+	// every worker has to check in, so none can still be reading mJob after this returns
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDone.wait(lock, [this]() { return mBusy == 0; });
+	mJob = nullptr;
+}
+
+void WorkerPool::workerLoop()
+{
+	unsigned seenGeneration = 0;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mWake.wait(lock, [this, seenGeneration]() { return mStop || mGeneration != seenGeneration; });
+		if (mStop)
+			return;
+		seenGeneration = mGeneration;
+
+		lock.unlock();
+		takeJobs();
+		lock.lock();
+
+		if (--mBusy == 0)
+			mDone.notify_one();
+	}
+}
+
+void WorkerPool::takeJobs()
+{
+	for (unsigned job = mNextJob++; job < mNumJobs; job = mNextJob++)
+		(*mJob)(job);
+}
@@ -0,0 +1,51 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// threads started once and reused by every per frame parallel loop, so no frame pays for thread creation
+// run() is meant to be called from one thread at a time and jobs must not call run() themselves
+class WorkerPool
+{
+public:
+	typedef std::function<void(unsigned job)> Job;
+
+	// the process wide pool with one worker less than the hardware threads, the caller is the last one
+	static WorkerPool& shared();
+
+	explicit WorkerPool(unsigned numWorkers);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// call job(0) .. job(numJobs - 1) spread over the workers and the calling thread, returns once all have finished
+	void run(unsigned numJobs, const Job& job);
+
+	// threads that can work on a run() at once, including the caller
+	unsigned getNumThreads() const { return static_cast<unsigned>(mWorkers.size()) + 1; }
+
+private:
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	std::condition_variable mWake;		// a new run started or the pool is stopping
+	std::condition_variable mDone;		// the last worker finished the current run
+	unsigned mGeneration = 0;			// counts runs so workers see each one once
+	unsigned mBusy = 0;					// workers still in the current run
+	bool mStop = false;
+
+	const Job* mJob = nullptr;
+	unsigned mNumJobs = 0;
+	std::atomic<unsigned> mNextJob;
+
+	void workerLoop();
+	void takeJobs();
+};
+
+#endif
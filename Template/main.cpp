@@ -1,15 +1,41 @@
 // include C++ headers
 #define _USE_MATH_DEFINES
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include "ShaderProgram.h"
+#include "RenderQueue.h"
+#include "ResolutionScaler.h"
+#include "ParticleSystem.h"
+#include "Simulation.h"
+#include "RewindBuffer.h"
+#include "StatsOverlay.h"
+#include "ResourceLoader.h"
+#include "Renderer.h"
+#include "SoftwareRenderer.h"
+#include "TruckGeometry.h"
+#include "CommandLine.h"
+#include "WorkerPool.h"
+#include "CpuSupport.h"
 //using namespace std;	// to avoid having to use std::
 
+// set to 0 for headless or kiosk builds without AntTweakBar, the stats overlay still works
+// the project sets this from its UseTweakBar property, which also drops AntTweakBar.lib from the link
+#ifndef USE_TWEAK_BAR
+#define USE_TWEAK_BAR 1
+#endif
+
 // include OpenGL related headers
 #include <GLEW/glew.h>
 #include <GLFW/glfw3.h>
+#if USE_TWEAK_BAR
 #include <AntTweakBar.h>
+#endif
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -33,7 +59,7 @@ struct VertexColor
 void initialiseVertices();
 void initialiseWheels();
 
-// global vertices vector
+// global vertices vector, only touched by the loader thread
 std::vector<GLfloat> vertices;
 
 // global variables
@@ -45,6 +71,33 @@ float gRotateSensitivity = 3.0f; // sense for rotation of wheels
 ShaderProgram gShader;	// shader program object
 GLuint gVBO = 0;		// vertex buffer object identifier
 GLuint gVAO = 0;		// vertex array object identifier
+RenderQueue gRenderQueue;	// sorted draw submission
+ResolutionScaler gResolutionScaler;	// scaled offscreen render target
+ShaderProgram gParticleShader;	// point sprite program for the load
+ParticleSystem gParticles;		// load carried in the tray
+unsigned int gParticleCount = 20000;	// requested number of particles
+Simulation gSimulation;			// trucks and obstacles on the road
+unsigned int gFleetSize = 5;	// requested number of trucks, including the player
+unsigned int gObstacleCount = 2;	// requested number of obstacles
+StatsOverlay gStatsOverlay;		// frame stats without the tweak bar
+ResourceLoader gResourceLoader;	// builds and uploads meshes off the render thread
+RewindBuffer gRewind;			// delta compressed history of the fleet
+bool gRewindView = false;		// show the history instead of the live fleet
+unsigned int gRewindTicksBack = 0;	// how far back to show
+std::vector<Truck> gRewindTrucks;	// last decoded snapshot
+std::uint64_t gRewindShownTick = 0;	// tick of gRewindTrucks
+GLRenderer gGLRenderer;			// draws the queue through OpenGL
+SoftwareRenderer gSoftwareRenderer;	// draws the queue on the CPU
+Renderer* gRenderer = &gGLRenderer;	// backend used for the scene
+bool gSoftwareRendering = false;	// use the software backend
+bool gCompareRequested = false;		// compare both backends before the next frame
+GLuint gSoftwareTexture = 0;		// software frame uploaded for display
+GLuint gSoftwareFBO = 0;			// read framebuffer for gSoftwareTexture
+int gSoftwareTextureWidth = 0;		// size gSoftwareTexture was allocated at
+int gSoftwareTextureHeight = 0;
+
+// mesh id the windowless modes register the truck under, there is no GL context to make a VAO in
+const GLuint SOFTWARE_TRUCK_MESH = 1;
 
 //model matrix
 std::map<std::string, glm::mat4> gModelMatrix;
@@ -55,7 +108,20 @@ float gFrameTime = 1 / gFramerate;
 
 double currentFrameTime;
 double deltaTime;
-double lastFrameTime = glfwGetTime();
+double lastFrameTime = 0.0;	// set once GLFW is initialised
+
+// render queue stats
+unsigned int gDrawCount = 0;
+unsigned int gStateChanges = 0;
+float gResolutionScale = 1.0f;
+float gParticleUpdateTime = 0.0f; // ms spent in ParticleSystem::update
+unsigned int gRewindHistory = 0;	// ticks held by the rewind buffer
+float gRewindMemory = 0.0f;			// KB used by the rewind buffer
+float gSoftwareTime = 0.0f;			// ms spent in the software backend
+float gCompareMismatch = 0.0f;		// % of pixels that differ between the backends
+unsigned int gCompareMaxDiff = 0;	// largest channel difference
+float gCompareGLTime = 0.0f;		// ms for the GL backend, including glFinish
+float gCompareSoftwareTime = 0.0f;	// ms for the software backend
 
 // Tweak bar variables
 float trayRotateAngleTwBar; // rotate angle for tray
@@ -115,29 +181,13 @@ void generate_circle(const float radius, const float scale_factor, std::vector<G
 	}
 }
 
-// function initialise scene and render settings
-static void init(GLFWwindow* window)
+// called on the render thread once the truck vertex buffer has been uploaded
+static void truck_mesh_loaded(const MeshResource& mesh)
 {
-	// set the color the color buffer should be cleared to
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-
-	gShader.compileAndLink("truck.vert", "truck.frag");
-
-	// creating model matrix for objects i want to manipulate
-	gModelMatrix["Truck"] = glm::mat4(1.0f);
-	gModelMatrix["FrontWheel"] = glm::mat4(1.0f);
-	gModelMatrix["BackWheel"] = glm::mat4(1.0f);
-	gModelMatrix["Tray"] = glm::mat4(1.0f);
-
-	initialiseVertices(); // initialises truck body vertices
-
-
-	// create VBO and buffer the data
-	glGenBuffers(1, &gVBO);					// generate unused VBO identifier
-	glBindBuffer(GL_ARRAY_BUFFER, gVBO);	// bind the VBO
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+	gVBO = mesh.vbo;	// VBO created by the loader, buffers are shared between contexts
 
 	// create VAO, specify VBO data and format of the data
+	// VAOs are not shared so it has to be made in the render context
 	glGenVertexArrays(1, &gVAO);			// generate unused VAO identifier
 	glBindVertexArray(gVAO);				// create VAO
 	glBindBuffer(GL_ARRAY_BUFFER, gVBO);	// bind the VBO
@@ -149,106 +199,458 @@ static void init(GLFWwindow* window)
 	glEnableVertexAttribArray(0);	// enable vertex attributes
 	glEnableVertexAttribArray(1);
 
+	// the software backend draws from the CPU copy, keyed by the same VAO
+	gSoftwareRenderer.setMesh(gVAO, mesh.vertices);
 }
 
-// function used to update scene before render
-static void update_scene(GLFWwindow* window) {
+// function initialise scene and render settings
+static void init(GLFWwindow* window)
+{
+	// set the color the color buffer should be cleared to
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-	// variables used for rotations/translations
-	static glm::vec3 truckMoveVec(0.0f);;
-	static glm::vec3 scaleVec(1.0f);
-	static float wheelRotateAngle = 0.0f;
-	
+	gShader.compileAndLink("truck.vert", "truck.frag");
 
-	// keeps track of frameTime/deltatime
-	currentFrameTime = glfwGetTime();
-	deltaTime = currentFrameTime - lastFrameTime;
-	lastFrameTime = currentFrameTime;
+	// creating model matrix for objects i want to manipulate
+	gModelMatrix["Truck"] = glm::mat4(1.0f);
+	gModelMatrix["FrontWheel"] = glm::mat4(1.0f);
+	gModelMatrix["BackWheel"] = glm::mat4(1.0f);
+	gModelMatrix["Tray"] = glm::mat4(1.0f);
 
-	float trayRotateAngle = -trayRotateAngleTwBar; // inverse of the TweakBar value
+	// build and upload the truck geometry on the loader thread, the scene is drawn once it arrives
+	gResourceLoader.start(window);
+	gResourceLoader.requestMesh("Truck", []() {
+		initialiseVertices(); // initialises truck body vertices
+		return vertices;
+	}, truck_mesh_loaded);
 
-	// updates background colour
-	glClearColor(gBackgroundColour.r, gBackgroundColour.g, gBackgroundColour.b, 1.0f);
+	// create the scaled render target
+	gResolutionScaler.resize(gWindowWidth, gWindowHeight);
 
-	if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-		truckMoveVec.x -= gTranslateSensitivity * deltaTime;
-		wheelRotateAngle += gRotateSensitivity * deltaTime;
-	}
-	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-		truckMoveVec.x += gTranslateSensitivity * deltaTime;
-		wheelRotateAngle -= gRotateSensitivity * deltaTime;
-	}
+	// particle program reuses the truck fragment shader
+	gParticleShader.compileAndLink("particle.vert", "truck.frag");
+	gParticleShader.use();
+	gParticleShader.setUniform("uPointSize", 2.0f);
+	glEnable(GL_PROGRAM_POINT_SIZE);
 
+	// the load collides with the same tray outline the mesh is built from
+	gParticles.setCollider(std::vector<glm::vec2>(TRAY_OUTLINE, TRAY_OUTLINE + TRAY_POINTS));
+	gParticles.reset(gParticleCount);
+
+}
+
+// builds the model matrices for a truck's parts
+static void truck_matrices(const Truck& state, glm::mat4& truck, glm::mat4& tray, glm::mat4& frontWheel, glm::mat4& backWheel)
+{
+	const glm::vec3 scaleVec(1.0f);
+	float trayRotateAngle = -state.trayAngle; // inverse of the TweakBar value
 
-	
 	// truck translation
-	gModelMatrix["Truck"] = glm::translate(truckMoveVec);
+	truck = glm::translate(glm::vec3(state.x, 0.0f, 0.0f));
 
 
 	// variables used for tray rotation
-	glm::vec3 trayRotatePoint(0.4f, -0.5f, 0.0f);
+	glm::vec3 trayRotatePoint(TRAY_PIVOT, 0.0f);
 	glm::mat4 trayTranslation = glm::translate(trayRotatePoint);
 	glm::mat4 trayTranslationInverse = glm::translate(-trayRotatePoint);
 
 	// tray transformation
 	// moves tray to centre origin based on bottom right vertex, rotates it, moves it back then translates with the truck
-	gModelMatrix["Tray"] = gModelMatrix["Truck"] * trayTranslation * glm::rotate(glm::radians(trayRotateAngle), glm::vec3(0.0f, 0.0f, 1.0f)) * trayTranslationInverse * glm::scale(scaleVec);
+	tray = truck * trayTranslation * glm::rotate(glm::radians(trayRotateAngle), glm::vec3(0.0f, 0.0f, 1.0f)) * trayTranslationInverse * glm::scale(scaleVec);
 
 
 	// Variables used for front wheel rotation
-	glm::vec3 frontWheelRotatePoint(-0.275f, -0.525f, 0.0f);
+	glm::vec3 frontWheelRotatePoint(FRONT_WHEEL_CENTRE, 0.0f);
 	glm::mat4 frontWheelTranslation = glm::translate(frontWheelRotatePoint);
 	glm::mat4 frontWheelTranslationInverse = glm::translate(-frontWheelRotatePoint);
 
 	// moves wheel to 0.0f, 0.0f, 0.0f, rotates it then moves it back to the correct position on the truck
-	gModelMatrix["FrontWheel"] = gModelMatrix["Truck"] *  frontWheelTranslation * glm::rotate(wheelRotateAngle, glm::vec3(0.0f, 0.0f, 1.0f)) * frontWheelTranslationInverse * glm::scale(scaleVec);
+	frontWheel = truck * frontWheelTranslation * glm::rotate(state.wheelAngle, glm::vec3(0.0f, 0.0f, 1.0f)) * frontWheelTranslationInverse * glm::scale(scaleVec);
 
 	// Variables used for front wheel rotation
-	glm::vec3 backWheelRotatePoint(0.275f, -0.525f, 0.0f);
+	glm::vec3 backWheelRotatePoint(BACK_WHEEL_CENTRE, 0.0f);
 	glm::mat4 backWheelTranslation = glm::translate(backWheelRotatePoint);
 	glm::mat4 backWheelTranslationInverse = glm::translate(-backWheelRotatePoint);
 
 	// moves wheel to 0.0f, 0.0f, 0.0f, rotates it then moves it back to the correct position on the truck
-	gModelMatrix["BackWheel"] = gModelMatrix["Truck"] * backWheelTranslation * glm::rotate(wheelRotateAngle, glm::vec3(0.0f, 0.0f, 1.0f))  * backWheelTranslationInverse * glm::scale(scaleVec);
+	backWheel = truck * backWheelTranslation * glm::rotate(state.wheelAngle, glm::vec3(0.0f, 0.0f, 1.0f)) * backWheelTranslationInverse * glm::scale(scaleVec);
+}
+
+// function used to update scene before render
+static void update_scene(GLFWwindow* window) {
+
+	// keeps track of frameTime/deltatime
+	currentFrameTime = glfwGetTime();
+	deltaTime = currentFrameTime - lastFrameTime;
+	lastFrameTime = currentFrameTime;
+
+	// pick the render scale for this frame
+	gResolutionScaler.update();
+	gStatsOverlay.addFrameTime(static_cast<float>(deltaTime));
 
+	// respawn the fleet when its size is changed
+	const Fleet& fleet = gSimulation.getFleet();
+	if (gFleetSize != fleet.getTrucks().size() || gObstacleCount != fleet.getObstacles().size())
+		gSimulation.reset(gFleetSize, gObstacleCount, true);
+
+	// the player drives truck 0
+	DriverInput input;
+	input.trayAngle = trayRotateAngleTwBar;
+
+	if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
+		input.speed -= gTranslateSensitivity;
+	}
+	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
+		input.speed += gTranslateSensitivity;
+	}
+
+	// move every truck and resolve collisions
+	gSimulation.getFleet().mWheelRatio = gRotateSensitivity / gTranslateSensitivity;
+	gSimulation.tick(static_cast<float>(deltaTime), input);
+
+	// keep the history and follow the scrub position, frames encode and seeks decode on workers so this never waits
+	gRewind.record(gSimulation.getTick(), fleet.getTrucks());
+	if (gRewindView)
+	{
+		std::uint64_t newest = gRewind.getNewestTick();
+		std::uint64_t back = std::min<std::uint64_t>(gRewindTicksBack, newest - gRewind.getOldestTick());
+		gRewind.requestSeek(newest - back);
+		gRewind.pollSeek(gRewindTrucks, gRewindShownTick);
+	}
+	else
+	{
+		// a seek still in flight is from an old scrub position, never show it when the view is turned back on
+		gRewind.cancelSeek();
+		gRewindTrucks.clear();
+	}
+	gRewindHistory = static_cast<unsigned int>(gRewind.empty() ? 0 : gRewind.getNewestTick() - gRewind.getOldestTick() + 1);
+	gRewindMemory = gRewind.getUsedBytes() / 1024.0f;
+
+	const Truck& player = fleet.getTrucks()[0];
+	truck_matrices(player, gModelMatrix["Truck"], gModelMatrix["Tray"], gModelMatrix["FrontWheel"], gModelMatrix["BackWheel"]);
+
+	// refill the tray when the particle count is changed
+	if (gParticleCount != gParticles.getCount())
+		gParticles.reset(gParticleCount);
+
+	// tip the load out of the tray
+	double particleStart = glfwGetTime();
+	gParticles.update(static_cast<float>(deltaTime), gModelMatrix["Tray"], trayRotateAngleTwBar);
+	gParticleUpdateTime = static_cast<float>((glfwGetTime() - particleStart) * 1000.0);
 	
 
 }
 
+// draws recorded per truck, truck i uses orders i * TRUCK_DRAWS onwards
+const std::uint32_t TRUCK_DRAWS = 8;
+
+// records the draws for one truck into a command buffer
+// does not touch GL so it can be called from any thread, order keeps the parts layered back to front
+static void record_truck(CommandBuffer& cmd, GLuint mesh, const glm::mat4& truck, const glm::mat4& tray, const glm::mat4& frontWheel, const glm::mat4& backWheel, std::uint32_t order)
+{
+	GLuint program = gShader.getID();
+	DrawPayload payload = { truck, &gShader, mesh, GL_TRIANGLE_STRIP, 0, 0 };
+
+	// truck base structure
+	payload.mode = GL_TRIANGLE_STRIP; payload.first = 0; payload.count = 6; // front cabin
+	cmd.draw(RenderQueue::makeKey(LAYER_SCENE, program, mesh, order + 0), payload);
+	payload.mode = GL_TRIANGLE_FAN; payload.first = 6; payload.count = 4; // window -  i used a fan here just to try out different types
+	cmd.draw(RenderQueue::makeKey(LAYER_SCENE, program, mesh, order + 1), payload);
+	payload.mode = GL_TRIANGLE_STRIP; payload.first = 16; payload.count = 4; // truck base
+	cmd.draw(RenderQueue::makeKey(LAYER_SCENE, program, mesh, order + 2), payload);
+
+	// dump box
+	payload.modelMatrix = tray;
+	payload.mode = GL_TRIANGLE_STRIP; payload.first = 10; payload.count = 6; // back tray
+	cmd.draw(RenderQueue::makeKey(LAYER_SCENE, program, mesh, order + 3), payload);
+
+	// wheels
+	payload.mode = GL_TRIANGLE_FAN;
+	payload.count = SLICES + 2;
+	payload.modelMatrix = frontWheel;
+	payload.first = 24; // front tyre
+	cmd.draw(RenderQueue::makeKey(LAYER_SCENE, program, mesh, order + 4), payload);
+	payload.first = 58; // front rim
+	cmd.draw(RenderQueue::makeKey(LAYER_SCENE, program, mesh, order + 5), payload);
+	payload.modelMatrix = backWheel;
+	payload.first = 92; // back tyre
+	cmd.draw(RenderQueue::makeKey(LAYER_SCENE, program, mesh, order + 6), payload);
+	payload.first = 126; // back rim
+	cmd.draw(RenderQueue::makeKey(LAYER_SCENE, program, mesh, order + 7), payload);
+}
+
+// x range on screen, models are drawn straight into clip space
+const float VIEW_MIN_X = -1.0f;
+const float VIEW_MAX_X = 1.0f;
+
+// trucks per command buffer, larger fleets are split over more buffers up to one per pool thread
+const unsigned int TRUCKS_PER_PARTITION = 256;
+
+// records trucks [begin, end) of the fleet or rewind snapshot, skipping anything off screen
+// only reads shared state, so partitions can be recorded on different threads
+static void record_fleet(CommandBuffer& cmd, GLuint mesh, const std::vector<Truck>& trucks, bool rewinding, unsigned begin, unsigned end)
+{
+	const Fleet& fleet = gSimulation.getFleet();
+
+	for (unsigned i = begin; i < end; i++)
+	{
+		// the fleet's bounds are from the live trucks, snapshots get theirs from the shapes at the recorded tray angle
+		float minX, maxX;
+		if (rewinding)
+		{
+			truck_extent(trucks[i], minX, maxX);
+			minX += trucks[i].x;
+			maxX += trucks[i].x;
+		}
+		else
+		{
+			minX = fleet.getMinX(i);
+			maxX = fleet.getMaxX(i);
+		}
+		if (maxX < VIEW_MIN_X || minX > VIEW_MAX_X)
+			continue;
+
+		glm::mat4 truck, tray, frontWheel, backWheel;
+		truck_matrices(trucks[i], truck, tray, frontWheel, backWheel);
+		record_truck(cmd, mesh, truck, tray, frontWheel, backWheel, i * TRUCK_DRAWS);
+	}
+}
+
+// records the frame into the render queue with the truck mesh, the load can be left out since only GL draws points
+// buffer 0 gets the ground, player, obstacles and load, the rest of the fleet is recorded into the other buffers on the worker pool
+static void record_scene(GLuint mesh, bool withEffects = true)
+{
+	gRenderQueue.reset();
+
+	// nothing to draw until the truck mesh has been uploaded
+	if (mesh == 0)
+		return;
+
+	// while scrubbing the history the trucks come from the rewind snapshot, the simulation keeps running
+	const Fleet& fleet = gSimulation.getFleet();
+	bool rewinding = gRewindView && !gRewindTrucks.empty();
+	const std::vector<Truck>& trucks = rewinding ? gRewindTrucks : fleet.getTrucks();
+
+	// grow the queue before taking buffer references, growing moves the buffers
+	unsigned numOthers = static_cast<unsigned>(trucks.size()) - 1;
+	unsigned numPartitions = std::min(WorkerPool::shared().getNumThreads(), (numOthers + TRUCKS_PER_PARTITION - 1) / TRUCKS_PER_PARTITION);
+	numPartitions = std::max(numPartitions, 1u);
+	if (gRenderQueue.getNumBuffers() < numPartitions + 1)
+		gRenderQueue.resize(numPartitions + 1);
+
+	CommandBuffer& cmd = gRenderQueue.getCommandBuffer(0);
+
+	DrawPayload ground = { glm::mat4(1.0f), &gShader, mesh, GL_TRIANGLE_STRIP, 20, 4 };
+	cmd.draw(RenderQueue::makeKey(LAYER_BACKGROUND, gShader.getID(), mesh, 0), ground);
+
+	if (rewinding)
+	{
+		glm::mat4 truck, tray, frontWheel, backWheel;
+		truck_matrices(trucks[0], truck, tray, frontWheel, backWheel);
+		record_truck(cmd, mesh, truck, tray, frontWheel, backWheel, 0);
+	}
+	else
+	{
+		record_truck(cmd, mesh, gModelMatrix["Truck"], gModelMatrix["Tray"], gModelMatrix["FrontWheel"], gModelMatrix["BackWheel"], 0);
+	}
+
+	// the rest of the fleet, one command buffer per partition
+	unsigned perPartition = (numOthers + numPartitions - 1) / numPartitions;
+	WorkerPool::shared().run(numPartitions, [mesh, &trucks, rewinding, perPartition](unsigned partition) {
+		unsigned begin = 1 + partition * perPartition;
+		unsigned end = std::min(begin + perPartition, static_cast<unsigned>(trucks.size()));
+		record_fleet(gRenderQueue.getCommandBuffer(partition + 1), mesh, trucks, rewinding, begin, end);
+	});
+
+	// obstacles, the unit quad is scaled to each box
+	// their orders start after the last truck's so boxes never sort between the parts of a truck
+	const std::vector<Obstacle>& obstacles = fleet.getObstacles();
+	std::uint32_t obstacleOrder = static_cast<std::uint32_t>(trucks.size()) * TRUCK_DRAWS;
+	for (unsigned i = 0; i < obstacles.size(); i++)
+	{
+		const Obstacle& obstacle = obstacles[i];
+		if (obstacle.x + obstacle.halfWidth < VIEW_MIN_X || obstacle.x - obstacle.halfWidth > VIEW_MAX_X)
+			continue;
+
+		glm::mat4 model = glm::translate(glm::vec3(obstacle.x, GROUND_Y, 0.0f)) * glm::scale(glm::vec3(obstacle.halfWidth, obstacle.height, 1.0f));
+		DrawPayload box = { model, &gShader, mesh, GL_TRIANGLE_STRIP, 160, 4 };
+		cmd.draw(RenderQueue::makeKey(LAYER_SCENE, gShader.getID(), mesh, obstacleOrder + i), box);
+	}
+
+	if (!withEffects)
+		return;
+
+	// the whole load is one point draw
+	DrawPayload load = { glm::mat4(1.0f), &gParticleShader, gParticles.getVAO(), GL_POINTS, 0, static_cast<GLsizei>(gParticles.getCount()) };
+	cmd.draw(RenderQueue::makeKey(LAYER_EFFECTS, gParticleShader.getID(), gParticles.getVAO(), 0), load);
+}
+
+// copies the software frame into the bound draw framebuffer at the viewport origin
+static void present_software_frame(const GLint* viewport)
+{
+	int width = gSoftwareRenderer.getWidth();
+	int height = gSoftwareRenderer.getHeight();
+
+	GLint drawFBO = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFBO);
+
+	if (gSoftwareTexture == 0)
+	{
+		glGenTextures(1, &gSoftwareTexture);
+		glGenFramebuffers(1, &gSoftwareFBO);
+	}
+
+	// reallocate when the viewport changes size
+	glBindTexture(GL_TEXTURE_2D, gSoftwareTexture);
+	if (width != gSoftwareTextureWidth || height != gSoftwareTextureHeight)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, gSoftwareFBO);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gSoftwareTexture, 0);
+		gSoftwareTextureWidth = width;
+		gSoftwareTextureHeight = height;
+	}
+
+	// rows are padded, pixels are RGBA bytes in memory
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, gSoftwareRenderer.getPitch());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, gSoftwareRenderer.getPixels().data());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, gSoftwareFBO);
+	glBlitFramebuffer(0, 0, width, height, viewport[0], viewport[1], viewport[0] + width, viewport[1] + height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, drawFBO);
+}
+
 // function to render the scene
 static void render_scene()
 {
-	// clear color buffer
-	glClear(GL_COLOR_BUFFER_BIT);
+	// stream the particle positions
+	gParticles.upload();
 
-	gShader.use();
+	// record and sort the draws, the backend issues them
+	record_scene(gVAO);
+	gRenderQueue.sort();
 
-	glBindVertexArray(gVAO);
+	// draw into the current viewport, which is the scaled target when dynamic resolution is active
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
 
-	
-	gShader.setUniform("uModelMatrix", glm::mat4(1.0f));
-	glDrawArrays(GL_TRIANGLE_STRIP, 20, 4); // ground
+	gRenderer = gSoftwareRendering ? static_cast<Renderer*>(&gSoftwareRenderer) : &gGLRenderer;
+	gRenderer->render(gRenderQueue, gBackgroundColour, viewport[2], viewport[3]);
 
-	// truck base structure
-	gShader.setUniform("uModelMatrix", gModelMatrix["Truck"]);
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 6); // front cabin
-	glDrawArrays(GL_TRIANGLE_FAN, 6, 4); // window -  i used a fan here just to try out different types
-	glDrawArrays(GL_TRIANGLE_STRIP, 16, 4); // truck base
+	if (gRenderer == &gSoftwareRenderer)
+	{
+		present_software_frame(viewport);
+		gSoftwareTime = gSoftwareRenderer.getBinTimeMs() + gSoftwareRenderer.getRasterTimeMs();
+	}
 
-	// dump box
-	gShader.setUniform("uModelMatrix", gModelMatrix["Tray"]);
-	glDrawArrays(GL_TRIANGLE_STRIP, 10, 6); // back tray
-	
-	// wheels
-	gShader.setUniform("uModelMatrix", gModelMatrix["FrontWheel"]);
-	glDrawArrays(GL_TRIANGLE_FAN, 24, SLICES + 2); // front tyre
-	glDrawArrays(GL_TRIANGLE_FAN, 58, SLICES + 2); // front rim
-	gShader.setUniform("uModelMatrix", gModelMatrix["BackWheel"]);
-	glDrawArrays(GL_TRIANGLE_FAN, 92, SLICES + 2); // back tyre
-	glDrawArrays(GL_TRIANGLE_FAN, 126, SLICES + 2); // back rim
-
-	// flush the graphics pipeline
-	glFlush();
+	gDrawCount = static_cast<unsigned int>(gRenderQueue.getDrawCount());
+	// only the GL backend changes GL state, the queue's count is left over from its last frame otherwise
+	gStateChanges = gRenderer == &gGLRenderer ? gRenderQueue.getStateChanges() : 0;
+}
+
+// renders the recorded queue with both backends and compares the pixels, the results go into the gCompare stats
+// GL draws into the bound framebuffer and is read back from the bound read buffer, each backend is timed over frames
+// returns the number of pixels with a channel difference above tolerance
+static unsigned int compare_backends(int width, int height, unsigned int tolerance, unsigned int frames)
+{
+	// the first frame of each backend sets up buffers, glFinish on both sides so only the GL work is timed
+	gGLRenderer.render(gRenderQueue, gBackgroundColour, width, height);
+	glFinish();
+	auto glStart = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < frames; i++)
+		gGLRenderer.render(gRenderQueue, gBackgroundColour, width, height);
+	glFinish();
+	gCompareGLTime = elapsed_ms(glStart) / frames;
+
+	std::vector<std::uint32_t> glPixels(static_cast<size_t>(width) * height);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, glPixels.data());
+
+	gSoftwareRenderer.render(gRenderQueue, gBackgroundColour, width, height);
+	auto softwareStart = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < frames; i++)
+		gSoftwareRenderer.render(gRenderQueue, gBackgroundColour, width, height);
+	gCompareSoftwareTime = elapsed_ms(softwareStart) / frames;
+
+	const std::vector<std::uint32_t>& softwarePixels = gSoftwareRenderer.getPixels();
+	unsigned int mismatched = 0;
+	unsigned int maxDiff = 0;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			std::uint32_t a = glPixels[y * width + x];
+			std::uint32_t b = softwarePixels[y * gSoftwareRenderer.getPitch() + x];
+
+			unsigned int pixelDiff = 0;
+			for (int shift = 0; shift < 24; shift += 8)
+			{
+				int diff = static_cast<int>((a >> shift) & 0xFF) - static_cast<int>((b >> shift) & 0xFF);
+				pixelDiff = std::max(pixelDiff, static_cast<unsigned int>(std::abs(diff)));
+			}
+
+			maxDiff = std::max(maxDiff, pixelDiff);
+			if (pixelDiff > tolerance)
+				mismatched++;
+		}
+	}
+
+	gCompareMismatch = 100.0f * mismatched / (width * height);
+	gCompareMaxDiff = maxDiff;
+
+	std::printf("Compare %dx%d: %.3f%% pixels differ, max channel diff %u, GL %.3f ms, software %.3f ms\n",
+		width, height, gCompareMismatch, gCompareMaxDiff, gCompareGLTime, gCompareSoftwareTime);
+	return mismatched;
+}
+
+// renders the current scene with both backends at window size and compares the pixels
+// the load is left out since the software backend does not draw points
+static void compare_renderers()
+{
+	int width = static_cast<int>(gWindowWidth);
+	int height = static_cast<int>(gWindowHeight);
+	if (width <= 0 || height <= 0)
+		return;
+
+	record_scene(gVAO, false);
+	gRenderQueue.sort();
+
+	// draw into the back buffer, the frame that follows overwrites it
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glReadBuffer(GL_BACK);
+
+	// colour interpolation can round differently by one step, anything more counts as a mismatch
+	compare_backends(width, height, 1, 1);
+}
+
+// fills the stats overlay for this frame and draws it
+static void draw_overlay()
+{
+	char line[64];
+
+	gStatsOverlay.mTargetFrameTimeMs = gResolutionScaler.mTargetFrameTimeMs;
+
+	std::snprintf(line, sizeof(line), "FPS %.1f", gFramerate);
+	gStatsOverlay.addLine(line);
+	std::snprintf(line, sizeof(line), "FRAME %.2f MS (%.2f-%.2f)", gStatsOverlay.getAverageMs(), gStatsOverlay.getMinMs(), gStatsOverlay.getMaxMs());
+	gStatsOverlay.addLine(line);
+	std::snprintf(line, sizeof(line), "DRAWS %u STATE %u", gDrawCount, gStateChanges);
+	gStatsOverlay.addLine(line);
+	std::snprintf(line, sizeof(line), "SCALE %.2f", gResolutionScale);
+	gStatsOverlay.addLine(line);
+	std::snprintf(line, sizeof(line), "RENDERER %s", gRenderer->getName());
+	gStatsOverlay.addLine(line);
+	const Fleet& fleet = gSimulation.getFleet();
+	std::snprintf(line, sizeof(line), "TRUCKS %u CONTACTS %u", static_cast<unsigned int>(fleet.getTrucks().size()), fleet.getStats().contacts);
+	gStatsOverlay.addLine(line);
+
+	gStatsOverlay.draw(gWindowWidth, gWindowHeight);
 }
 
 //frame buffer callback function
@@ -258,15 +660,20 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 	gWindowHeight = height;
 
 	glViewport(0, 0, gWindowWidth, gWindowHeight);
+	gResolutionScaler.resize(gWindowWidth, gWindowHeight);
 
+#if USE_TWEAK_BAR
 	TwWindowSize(gWindowWidth, gWindowHeight);
+#endif
 }
 
 // cursor movement callback function
 static void cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
 {
+#if USE_TWEAK_BAR
 	// pass cursor position to tweak bar
 	TwEventMousePosGLFW(static_cast<int>(xpos), static_cast<int>(ypos));
+#endif
 
 
 }
@@ -280,8 +687,10 @@ static void error_callback(int error, const char* description)
 // mouse button callback function
 static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
+#if USE_TWEAK_BAR
 	// pass mouse button status to tweak bar
 	TwEventMouseButtonGLFW(button, action);
+#endif
 }
 
 // key callback function
@@ -293,8 +702,36 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 		return;
 	}
 
+	// toggles the stats overlay
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+		gStatsOverlay.mVisible = !gStatsOverlay.mVisible;
+	}
+
+	// switches between the GL and software backends
+	if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
+		gSoftwareRendering = !gSoftwareRendering;
+	}
+
+	// compares the two backends on the next frame
+	if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+		gCompareRequested = true;
+	}
+
+}
+
+
+#if USE_TWEAK_BAR
+// tweak bar button callback, puts the load back in the tray
+static void TW_CALL refill_tray(void* clientData)
+{
+	gParticles.reset(gParticleCount);
 }
 
+// tweak bar button callback, compares the backends on the next frame
+static void TW_CALL request_compare_callback(void* clientData)
+{
+	gCompareRequested = true;
+}
 
 // create and populate tweak bar elements
 TwBar* create_UI(const std::string name)
@@ -308,17 +745,350 @@ TwBar* create_UI(const std::string name)
 	TwDefine(" Main label='MyGUI' refresh=0.02 text=light size='220 320' ");
 	TwAddVarRO(twBar, "Frame Rate", TW_TYPE_FLOAT, &gFramerate, " group='Frame Stats' precision=2 ");
 	TwAddVarRO(twBar, "Frame Time", TW_TYPE_FLOAT, &gFrameTime, " group='Frame Stats' ");
+	TwAddVarRO(twBar, "Draw Calls", TW_TYPE_UINT32, &gDrawCount, " group='Frame Stats' ");
+	TwAddVarRO(twBar, "State Changes", TW_TYPE_UINT32, &gStateChanges, " group='Frame Stats' ");
 	TwAddVarRW(twBar, "Wireframe", TW_TYPE_BOOLCPP, &gWireFrame, " group='Display' "); // toggles wireframe mode
+	TwAddVarRW(twBar, "Stats Overlay", TW_TYPE_BOOLCPP, &gStatsOverlay.mVisible, " group='Display' "); // toggles the overlay
 	TwAddVarRW(twBar, "BgColour", TW_TYPE_COLOR3F, &gBackgroundColour, " label='Background Colour' group='Display' opened=true "); // updates bg colour
+	TwAddVarRW(twBar, "Dynamic Resolution", TW_TYPE_BOOLCPP, &gResolutionScaler.mEnabled, " group='Resolution' "); // toggles scaled rendering
+	TwAddVarRW(twBar, "Target (ms)", TW_TYPE_FLOAT, &gResolutionScaler.mTargetFrameTimeMs, " group='Resolution' min=1.0 max=100.0 step=0.1 "); // render time to hold
+	TwAddVarRW(twBar, "Min Scale", TW_TYPE_FLOAT, &gResolutionScaler.mMinScale, " group='Resolution' min=0.1 max=1.0 step=0.05 ");
+	TwAddVarRO(twBar, "Scale", TW_TYPE_FLOAT, &gResolutionScale, " group='Resolution' precision=2 ");
 	TwAddSeparator(twBar, nullptr, nullptr);
 
 	TwAddVarRW(twBar, "Angle", TW_TYPE_FLOAT, &trayRotateAngleTwBar, " group='Tipper Angle' min=0.0 max=45.0 step=.1 "); // to update tray angle
+	TwAddSeparator(twBar, nullptr, nullptr);
+
+	TwAddVarRW(twBar, "Particles", TW_TYPE_UINT32, &gParticleCount, " group='Load' min=0 max=200000 step=1000 "); // changing it refills the tray
+	TwAddVarRW(twBar, "Threads", TW_TYPE_UINT32, &gParticles.mNumThreads, " group='Load' min=1 max=32 ");
+	TwAddVarRO(twBar, "Update (ms)", TW_TYPE_FLOAT, &gParticleUpdateTime, " group='Load' precision=3 ");
+	TwAddButton(twBar, "Refill", refill_tray, nullptr, " group='Load' ");
+	TwAddSeparator(twBar, nullptr, nullptr);
+
+	const FleetStats& fleetStats = gSimulation.getFleet().getStats();
+	TwAddVarRW(twBar, "Trucks", TW_TYPE_UINT32, &gFleetSize, " group='Fleet' min=1 max=200000 "); // changing it respawns the fleet
+	TwAddVarRW(twBar, "Obstacles", TW_TYPE_UINT32, &gObstacleCount, " group='Fleet' min=0 max=1000 ");
+	TwAddVarRO(twBar, "Candidate Pairs", TW_TYPE_UINT32, &fleetStats.candidatePairs, " group='Fleet' ");
+	TwAddVarRO(twBar, "Contacts", TW_TYPE_UINT32, &fleetStats.contacts, " group='Fleet' ");
+	TwAddVarRO(twBar, "Broad Phase (ms)", TW_TYPE_FLOAT, &fleetStats.broadPhaseMs, " group='Fleet' precision=3 ");
+	TwAddVarRO(twBar, "Narrow Phase (ms)", TW_TYPE_FLOAT, &fleetStats.narrowPhaseMs, " group='Fleet' precision=3 ");
+	TwAddSeparator(twBar, nullptr, nullptr);
+
+	TwAddVarRW(twBar, "View History", TW_TYPE_BOOLCPP, &gRewindView, " group='Rewind' "); // shows the snapshot instead of the live fleet
+	TwAddVarRW(twBar, "Ticks Back", TW_TYPE_UINT32, &gRewindTicksBack, " group='Rewind' min=0 step=10 ");
+	TwAddVarRO(twBar, "History (ticks)", TW_TYPE_UINT32, &gRewindHistory, " group='Rewind' ");
+	TwAddVarRO(twBar, "Memory (KB)", TW_TYPE_FLOAT, &gRewindMemory, " group='Rewind' precision=0 ");
+	TwAddSeparator(twBar, nullptr, nullptr);
+
+	TwAddVarRW(twBar, "Software", TW_TYPE_BOOLCPP, &gSoftwareRendering, " group='Renderer' "); // draws the scene on the CPU, without the load
+	TwAddVarRO(twBar, "Software (ms)", TW_TYPE_FLOAT, &gSoftwareTime, " group='Renderer' precision=3 ");
+	TwAddButton(twBar, "Compare", request_compare_callback, nullptr, " group='Renderer' ");
+	TwAddVarRO(twBar, "Mismatch (%)", TW_TYPE_FLOAT, &gCompareMismatch, " group='Renderer' precision=3 ");
+	TwAddVarRO(twBar, "Max Diff", TW_TYPE_UINT32, &gCompareMaxDiff, " group='Renderer' ");
+	TwAddVarRO(twBar, "GL (ms)", TW_TYPE_FLOAT, &gCompareGLTime, " group='Renderer' precision=3 ");
+	TwAddVarRO(twBar, "CPU (ms)", TW_TYPE_FLOAT, &gCompareSoftwareTime, " group='Renderer' precision=3 ");
 
 	return twBar;
 }
+#endif
 
-int main(void)
+// settings for the headless render and compare modes, parsed from the command line
+struct HeadlessSettings
 {
+	std::string output;				// PPM file to write, render mode only
+	unsigned int numTrucks = 5;		// trucks in the scene, including the player
+	unsigned int numObstacles = 2;	// obstacles on the road
+	unsigned int ticks = 120;		// simulation ticks before the frame is drawn
+	unsigned int frames = 20;		// times the frame is rendered for the timing
+	unsigned int tolerance = 1;		// largest channel difference between the backends that still matches, compare mode only
+	int width = 800;
+	int height = 600;
+};
+
+static const char* RENDER_USAGE = "TruckProject --render out.ppm [trucks] [--ticks n] [--obstacles n] [--frames n] [--size WxH]";
+static const char* COMPARE_USAGE = "TruckProject --compare [trucks] [--ticks n] [--obstacles n] [--frames n] [--size WxH] [--tolerance n]";
+
+// options both headless modes take
+static std::vector<CommandOption> headless_options(HeadlessSettings& settings)
+{
+	return {
+		{ nullptr, [&settings](const char* value) { return parse_unsigned(value, settings.numTrucks, 1); } },
+		{ "--ticks", [&settings](const char* value) { return parse_unsigned(value, settings.ticks); } },
+		{ "--obstacles", [&settings](const char* value) { return parse_unsigned(value, settings.numObstacles); } },
+		{ "--frames", [&settings](const char* value) { return parse_unsigned(value, settings.frames, 1); } },
+		{ "--size", [&settings](const char* value) { return parse_size(value, settings.width, settings.height); } },
+	};
+}
+
+// fill settings from the arguments after --render, prints usage and returns false if they are invalid
+static bool parse_render_args(int argc, char** argv, HeadlessSettings& settings)
+{
+	// the output file is the first positional argument, before the truck count
+	std::vector<CommandOption> options = headless_options(settings);
+	options.insert(options.begin(), { nullptr, [&settings](const char* value) { settings.output = value; return true; } });
+
+	if (!parse_command_line(argc, argv, 2, options, RENDER_USAGE))
+		return false;
+
+	if (settings.output.empty())
+	{
+		std::cerr << "Missing output file" << std::endl << "usage: " << RENDER_USAGE << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// fill settings from the arguments after --compare, prints usage and returns false if they are invalid
+static bool parse_compare_args(int argc, char** argv, HeadlessSettings& settings)
+{
+	std::vector<CommandOption> options = headless_options(settings);
+	options.push_back({ "--tolerance", [&settings](const char* value) { return parse_unsigned(value, settings.tolerance, 0, 255); } });
+
+	return parse_command_line(argc, argv, 2, options, COMPARE_USAGE);
+}
+
+// runs the simulation for the requested ticks and records the frame without the load, drawing from mesh
+static void record_headless_scene(const HeadlessSettings& settings, GLuint mesh)
+{
+	gSimulation.reset(settings.numTrucks, settings.numObstacles, true);
+	DriverInput input;
+	for (unsigned int i = 0; i < settings.ticks; i++)
+		gSimulation.tick(1.0f / 60.0f, input);
+
+	const Truck& player = gSimulation.getFleet().getTrucks()[0];
+	truck_matrices(player, gModelMatrix["Truck"], gModelMatrix["Tray"], gModelMatrix["FrontWheel"], gModelMatrix["BackWheel"]);
+
+	record_scene(mesh, false);
+	gRenderQueue.sort();
+}
+
+// simulates, renders the scene with the software backend and writes it out, no GLFW or GL calls are made
+// reports the render time on stdout, returns the process exit code
+static int run_headless_render(const HeadlessSettings& settings)
+{
+	// the mesh stays on the CPU
+	initialiseVertices();
+	gSoftwareRenderer.setMesh(SOFTWARE_TRUCK_MESH, vertices);
+	record_headless_scene(settings, SOFTWARE_TRUCK_MESH);
+
+	// first frame sizes the buffers, the rest are timed
+	gSoftwareRenderer.render(gRenderQueue, gBackgroundColour, settings.width, settings.height);
+	float binTime = 0.0f;
+	float rasterTime = 0.0f;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < settings.frames; i++)
+	{
+		gSoftwareRenderer.render(gRenderQueue, gBackgroundColour, settings.width, settings.height);
+		binTime += gSoftwareRenderer.getBinTimeMs();
+		rasterTime += gSoftwareRenderer.getRasterTimeMs();
+	}
+	float totalTime = elapsed_ms(start);
+
+	std::printf("Rendered %dx%d, %u draws on %u threads: %.3f ms per frame (bin %.3f, raster %.3f)\n",
+		settings.width, settings.height, static_cast<unsigned int>(gRenderQueue.getDrawCount()), WorkerPool::shared().getNumThreads(),
+		totalTime / settings.frames, binTime / settings.frames, rasterTime / settings.frames);
+
+	// binary PPM, top row first
+	std::ofstream file(settings.output, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Could not open " << settings.output << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	file << "P6\n" << settings.width << " " << settings.height << "\n255\n";
+	std::vector<char> row(settings.width * 3);
+	for (int y = settings.height - 1; y >= 0; y--)
+	{
+		const std::uint32_t* pixels = &gSoftwareRenderer.getPixels()[y * gSoftwareRenderer.getPitch()];
+		for (int x = 0; x < settings.width; x++)
+		{
+			row[x * 3 + 0] = static_cast<char>(pixels[x] & 0xFF);
+			row[x * 3 + 1] = static_cast<char>((pixels[x] >> 8) & 0xFF);
+			row[x * 3 + 2] = static_cast<char>((pixels[x] >> 16) & 0xFF);
+		}
+		file.write(row.data(), row.size());
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// simulates, then renders the scene with both backends into an offscreen target of a hidden window and compares them
+// prints the difference and the time per frame of each backend, returns a failing exit code on a mismatch
+static int run_headless_compare(const HeadlessSettings& settings)
+{
+	glfwSetErrorCallback(error_callback);
+	if (!glfwInit())
+	{
+		std::cerr << "GLFW initialisation failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// same context as the main window, never shown
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(1, 1, "Compare", nullptr, nullptr);
+	if (window == nullptr)
+	{
+		std::cerr << "Failed to create a GL context to compare against" << std::endl;
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	glfwMakeContextCurrent(window);
+	if (glewInit() != GLEW_OK)
+	{
+		std::cerr << "GLEW initialisation failed" << std::endl;
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	// upload the truck on this thread, the loader callback makes the VAO and hands the CPU copy to the software backend
+	gShader.compileAndLink("truck.vert", "truck.frag");
+	initialiseVertices();
+	MeshResource mesh;
+	mesh.name = "Truck";
+	mesh.size = static_cast<GLsizeiptr>(sizeof(GLfloat) * vertices.size());
+	mesh.vertices = vertices;
+	glGenBuffers(1, &mesh.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+	glBufferData(GL_ARRAY_BUFFER, mesh.size, vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	truck_mesh_loaded(mesh);
+
+	record_headless_scene(settings, gVAO);
+
+	// the window's own framebuffer is 1x1, draw into a target of the requested size
+	GLuint fbo = 0;
+	GLuint colour = 0;
+	glGenRenderbuffers(1, &colour);
+	glBindRenderbuffer(GL_RENDERBUFFER, colour);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, settings.width, settings.height);
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+
+	int result = EXIT_FAILURE;
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "Failed to create a " << settings.width << "x" << settings.height << " render target" << std::endl;
+	}
+	else
+	{
+		glViewport(0, 0, settings.width, settings.height);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		unsigned int mismatched = compare_backends(settings.width, settings.height, settings.tolerance, settings.frames);
+		if (mismatched == 0)
+			result = EXIT_SUCCESS;
+		else
+			std::cerr << mismatched << " pixels differ by more than " << settings.tolerance << std::endl;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &colour);
+	glDeleteVertexArrays(1, &gVAO);
+	glDeleteBuffers(1, &gVBO);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return result;
+}
+
+// settings for the particle sweep, parsed from the command line
+struct SweepSettings
+{
+	std::vector<unsigned int> counts = { 1000, 5000, 20000, 50000, 100000, 200000 };
+	unsigned int frames = 300;		// frames per count, the tray tips from 0 to 45 degrees over them
+	unsigned int jobs = 0;			// chunks per update, 0 uses one per pool thread
+};
+
+static const char* SWEEP_USAGE = "TruckProject --particle-sweep [--counts n,n,...] [--frames n] [--jobs n]";
+
+// fill settings from the arguments after --particle-sweep, prints usage and returns false if they are invalid
+static bool parse_sweep_args(int argc, char** argv, SweepSettings& settings)
+{
+	std::vector<CommandOption> options = {
+		{ "--counts", [&settings](const char* value) { return parse_unsigned_list(value, settings.counts, 1); } },
+		{ "--frames", [&settings](const char* value) { return parse_unsigned(value, settings.frames, 1); } },
+		{ "--jobs", [&settings](const char* value) { return parse_unsigned(value, settings.jobs, 1, 256); } },
+	};
+
+	return parse_command_line(argc, argv, 2, options, SWEEP_USAGE);
+}
+
+// times ParticleSystem::update for each particle count with a fixed tipping sequence, no window or GL
+// prints one row per count, returns the process exit code
+static int run_particle_sweep(const SweepSettings& settings)
+{
+	ParticleSystem particles;
+	particles.setCollider(std::vector<glm::vec2>(TRAY_OUTLINE, TRAY_OUTLINE + TRAY_POINTS));
+	particles.mNumThreads = settings.jobs != 0 ? settings.jobs : WorkerPool::shared().getNumThreads();
+
+	std::printf("%u frames per count, %u jobs on %u threads\n", settings.frames, particles.mNumThreads, WorkerPool::shared().getNumThreads());
+	std::printf("%10s %10s %10s %10s\n", "particles", "avg ms", "min ms", "max ms");
+
+	for (unsigned int count : settings.counts)
+	{
+		particles.reset(count);
+
+		float total = 0.0f;
+		float minTime = 1.0e30f;
+		float maxTime = 0.0f;
+		for (unsigned int frame = 0; frame < settings.frames; frame++)
+		{
+			// same tipping sequence for every count, so rows are comparable between runs
+			Truck truck;
+			truck.trayAngle = settings.frames > 1 ? 45.0f * frame / (settings.frames - 1) : 45.0f;
+			glm::mat4 truckMatrix, trayMatrix, frontWheel, backWheel;
+			truck_matrices(truck, truckMatrix, trayMatrix, frontWheel, backWheel);
+
+			auto start = std::chrono::steady_clock::now();
+			particles.update(1.0f / 60.0f, trayMatrix, truck.trayAngle);
+			float time = elapsed_ms(start);
+
+			total += time;
+			minTime = std::min(minTime, time);
+			maxTime = std::max(maxTime, time);
+		}
+
+		std::printf("%10u %10.3f %10.3f %10.3f\n", count, total / settings.frames, minTime, maxTime);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+	// particle count against update time, no window
+	if (argc > 1 && std::strcmp(argv[1], "--particle-sweep") == 0)
+	{
+		SweepSettings sweepSettings;
+		if (!parse_sweep_args(argc, argv, sweepSettings))
+			return EXIT_FAILURE;
+		return run_particle_sweep(sweepSettings);
+	}
+
+	// one frame with the software backend and no window, for hosts without a GPU
+	if (argc > 1 && std::strcmp(argv[1], "--render") == 0)
+	{
+		HeadlessSettings renderSettings;
+		if (!parse_render_args(argc, argv, renderSettings))
+			return EXIT_FAILURE;
+		return run_headless_render(renderSettings);
+	}
+
+	// the same frame through both backends in a hidden window, fails if they disagree
+	if (argc > 1 && std::strcmp(argv[1], "--compare") == 0)
+	{
+		HeadlessSettings compareSettings;
+		if (!parse_compare_args(argc, argv, compareSettings))
+			return EXIT_FAILURE;
+		return run_headless_compare(compareSettings);
+	}
+
 	GLFWwindow* window = nullptr;	// GLFW window handle
 
 	glfwSetErrorCallback(error_callback);	// set GLFW error callback function
@@ -366,11 +1136,17 @@ int main(void)
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
+#if USE_TWEAK_BAR
 	// tweak bar setup
 	TwInit(TW_OPENGL_CORE, nullptr);
-	TwBar* tweakBar = create_UI("Main");
+	create_UI("Main");
+#endif
+
+	// stats overlay setup
+	gStatsOverlay.init();
 
 	// timing data
+	lastFrameTime = glfwGetTime();
 	double lastUpdateTime = glfwGetTime();	// last update time
 	double elapsedTime = lastUpdateTime;	// time since last update
 	int frameCount = 0;						// number of frames since last update
@@ -378,16 +1154,34 @@ int main(void)
 	// the rendering loop
 	while (!glfwWindowShouldClose(window))
 	{
+		gResourceLoader.poll();	// pick up finished uploads
 		update_scene(window);
 
+		if (gCompareRequested)
+		{
+			compare_renderers();
+			gCompareRequested = false;
+		}
+
 		// changes wireframe mode if gWireFrame == true
 		if (gWireFrame) { glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);}
 
+		gResolutionScaler.begin();
 		render_scene();		// render the scene
+		gResolutionScaler.end();	// upscale before the UI so it stays at native resolution
+		gResolutionScale = gResolutionScaler.getScale();
 
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); // changes write frame to FILL if !gWireFrame
 
+		// overlay at native resolution, after the upscale
+		if (gStatsOverlay.mVisible)
+		{
+			draw_overlay();
+		}
+
+#if USE_TWEAK_BAR
 		TwDraw();
+#endif
 
 		glfwSwapBuffers(window);	// swap buffers
 		glfwPollEvents();			// poll for events
@@ -407,6 +1201,7 @@ int main(void)
 	}
 
 	// close the window and terminate GLFW
+	gResourceLoader.stop();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
@@ -422,28 +1217,28 @@ void initialiseVertices() {
 		// Truck front cabin - 6 vertices
 		//
 		// bottom right
-		-0.13f, -0.5f, 0.0f, // x same as top right
+		CABIN_OUTLINE[1].x, CABIN_OUTLINE[1].y, 0.0f, // x same as top right
 		1.0f, 0.0f, 0.0f,
 
 
 		// bottom left
-		-0.4, -0.5f, 0.0f, // y same as bottom right, x same as
+		CABIN_OUTLINE[0].x, CABIN_OUTLINE[0].y, 0.0f, // y same as bottom right, x same as
 		1.0f, 0.0f, 0.0f,
 
 		// middle right
-		-0.13f, -0.275, 0.0f,
+		CABIN_OUTLINE[1].x, TRAY_OUTLINE[1].y, 0.0f, // meets the tray's middle left
 		1.0f, 0.0f, 0.0f,
 
 		// middle left
-		-0.4, -0.2, 0.0f, // x same as bottom left
+		CABIN_OUTLINE[4].x, CABIN_OUTLINE[4].y, 0.0f, // x same as bottom left
 		0.0f, 1.0f, 0.0f,
 
 		// top right vertex
-		-0.13f, -0.05f, 0.0f, // vertex
+		CABIN_OUTLINE[2].x, CABIN_OUTLINE[2].y, 0.0f, // vertex
 		0.0f, 1.0f, 0.0f, // colour
 
 		// top left
-		-0.32f, -0.05f, 0.0f, // y same as top right
+		CABIN_OUTLINE[3].x, CABIN_OUTLINE[3].y, 0.0f, // y same as top right
 		0.0f, 1.0f, 0.0f,
 
 		// Truck front window - 4 vertices
@@ -467,56 +1262,56 @@ void initialiseVertices() {
 		// Truck tray/bucket - 6 vertices
 		// 
 		// top left
-		-0.05f, -0.08f, 0.0f,
+		TRAY_OUTLINE[0].x, TRAY_OUTLINE[0].y, 0.0f,
 		0.0f, 0.0f, 1.0f,
 
 		// top right
-		0.4f, -0.08f, 0.0f, // y same as top left
+		TRAY_OUTLINE[5].x, TRAY_OUTLINE[5].y, 0.0f, // y same as top left
 		0.0f, 0.0f, 1.0f,
 		
 		// middle left
-		-0.13f, -0.275, 0.0f,
+		TRAY_OUTLINE[1].x, TRAY_OUTLINE[1].y, 0.0f,
 		0.0f, 0.0f, 1.0f,
 
 		// middle right
-		0.48f, -0.275f, 0.0f, // y same as middle left
+		TRAY_OUTLINE[4].x, TRAY_OUTLINE[4].y, 0.0f, // y same as middle left
 		0.0f, 0.5f, 0.5f,
 
 		// bottom left
-		-0.05f, -0.5f, 0.0f,
+		TRAY_OUTLINE[2].x, TRAY_OUTLINE[2].y, 0.0f,
 		0.0f, 0.5f, 0.5f,
 
 		// bottom right
-		0.4f, -0.5f, 0.0f, // x same as top right
+		TRAY_OUTLINE[3].x, TRAY_OUTLINE[3].y, 0.0f, // x same as top right
 		0.0f, 0.5f, 0.5f,
 
 
 
 		// Truck base - 4 vertices
 		// top left
-		-0.4, -0.5, -0.0f,
+		BASE_OUTLINE[3].x, BASE_OUTLINE[3].y, 0.0f,
 		0.8f, 0.8f, 0.8f,
 
 		// top right
-		0.4f, -0.5, 0.0f, // y same as top left
+		BASE_OUTLINE[2].x, BASE_OUTLINE[2].y, 0.0f, // y same as top left
 		0.8f, 0.8f, 0.8f,
 
 		// bottom left
-		-0.4, -0.55, 0.0f, // x same as top left
+		BASE_OUTLINE[0].x, BASE_OUTLINE[0].y, 0.0f, // x same as top left
 		0.2f, 0.2f, 0.2f,
 
 		// bottom right
-		0.4f, -0.55, 0.0f, // x same as top right, y same as bottom left
+		BASE_OUTLINE[1].x, BASE_OUTLINE[1].y, 0.0f, // x same as top right, y same as bottom left
 		0.2f, 0.2f, 0.2f,
 
 		// ground - 4 vertices
 		// can use co-ords of y of wheel + radius of tyre to get point of contact
 		// top left
-		-1.0f, -0.625f, 0.0f,
+		-1.0f, GROUND_Y, 0.0f,
 		0.0f, 0.8f, 0.2f,
 
 		// top right
-		1.0f, -0.625, 0.0f,
+		1.0f, GROUND_Y, 0.0f,
 		0.0f, 0.6f, 0.4f,
 
 		// bottom left
@@ -545,8 +1340,8 @@ void initialiseWheels() {
 	// 
 	// front tyre
 	// centre vertex
-	x = -0.275f;
-	y = -0.525f;
+	x = FRONT_WHEEL_CENTRE.x;
+	y = FRONT_WHEEL_CENTRE.y;
 	vertices.push_back(x);
 	vertices.push_back(y);
 	vertices.push_back(z);
@@ -555,12 +1350,12 @@ void initialiseWheels() {
 	vertices.push_back(0.6f);
 	vertices.push_back(0.6f);
 
-	generate_circle(0.12f, 1.0f, vertices, x, y, false); // generates front tyre
+	generate_circle(TYRE_RADIUS, 1.0f, vertices, x, y, false); // generates front tyre
 
 	// front rim
 	// centre vertex
-	x = -0.275f;
-	y = -0.525f;
+	x = FRONT_WHEEL_CENTRE.x;
+	y = FRONT_WHEEL_CENTRE.y;
 	vertices.push_back(x);
 	vertices.push_back(y);
 	vertices.push_back(z);
@@ -569,13 +1364,13 @@ void initialiseWheels() {
 	vertices.push_back(0.9f);
 	vertices.push_back(0.9f);
 
-	generate_circle(0.07f, 1.0f, vertices, x, y, true); // generates front rim
+	generate_circle(RIM_RADIUS, 1.0f, vertices, x, y, true); // generates front rim
 
 	// back tyre
 	//
 	// centre vertex
-	x = 0.275f;
-	y = -0.525f;
+	x = BACK_WHEEL_CENTRE.x;
+	y = BACK_WHEEL_CENTRE.y;
 	vertices.push_back(x);
 	vertices.push_back(y);
 	vertices.push_back(z);
@@ -584,13 +1379,13 @@ void initialiseWheels() {
 	vertices.push_back(0.6f);
 	vertices.push_back(0.6f);
 
-	generate_circle(0.12f, 1.0f, vertices, x, y, false); // generates back tyre
+	generate_circle(TYRE_RADIUS, 1.0f, vertices, x, y, false); // generates back tyre
 
 	// back rim 
 	//
 	// centre vertex
-	x = 0.275f;
-	y = -0.525f;
+	x = BACK_WHEEL_CENTRE.x;
+	y = BACK_WHEEL_CENTRE.y;
 	vertices.push_back(x);
 	vertices.push_back(y);
 	vertices.push_back(z);
@@ -599,6 +1394,21 @@ void initialiseWheels() {
 	vertices.push_back(0.9f);
 	vertices.push_back(0.9f);
 
-	generate_circle(0.07f, 1.0f, vertices, x, y, true); // generates back rim
+	generate_circle(RIM_RADIUS, 1.0f, vertices, x, y, true); // generates back rim
 
+	// obstacle - 4 vertices
+	// unit box standing on y = 0, scaled and moved into place by its model matrix
+	vertices.insert(vertices.end(), {
+		-1.0f, 1.0f, 0.0f,
+		0.8f, 0.5f, 0.1f,
+
+		1.0f, 1.0f, 0.0f,
+		0.8f, 0.5f, 0.1f,
+
+		-1.0f, 0.0f, 0.0f,
+		0.5f, 0.3f, 0.05f,
+
+		1.0f, 0.0f, 0.0f,
+		0.5f, 0.3f, 0.05f,
+	});
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+#version 330 core
+
+// input data
+layout(location = 0) in vec2 aPosition;
+layout(location = 1) in vec2 aTexCoord;
+layout(location = 2) in vec4 aColor;
+
+// window size in pixels
+uniform vec2 uScreenSize;
+
+// output data
+out vec2 vTexCoord;
+out vec4 vColor;
+
+void main()
+{
+	// pixels from the top left to clip space
+	vec2 ndc = aPosition / uScreenSize * 2.0f - 1.0f;
+	gl_Position = vec4(ndc.x, -ndc.y, 0.0f, 1.0f);
+
+	vTexCoord = aTexCoord;
+	vColor = aColor;
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+// input data, x and y come from separate streams
+layout(location = 0) in float aPositionX;
+layout(location = 1) in float aPositionY;
+
+// model space matrix
+uniform mat4 uModelMatrix;
+
+// size of a particle in pixels
+uniform float uPointSize;
+
+// output data
+out vec3 vColor;
+
+void main()
+{
+	// set vertex position
+	gl_Position = uModelMatrix * vec4(aPositionX, aPositionY, 0.0f, 1.0f);
+	gl_PointSize = uPointSize;
+
+	// vary the shade per particle so the load looks granular
+	float shade = fract(sin(float(gl_VertexID) * 12.9898f) * 43758.5453f);
+	vColor = mix(vec3(0.45f, 0.3f, 0.15f), vec3(0.65f, 0.5f, 0.3f), shade);
+}